@@ -0,0 +1,67 @@
+/***************************************************************************
+ *   Copyright 2026 KDevelop developers                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "controlflowgraphcache.h"
+
+namespace {
+    const int MAX_CACHED_FUNCTIONS = 4096;
+}
+
+ControlFlowGraphCache::ControlFlowGraphCache()
+: m_callees(MAX_CACHED_FUNCTIONS), m_functionInfos(MAX_CACHED_FUNCTIONS)
+{
+}
+
+bool ControlFlowGraphCache::callees(const IndexedDeclaration &definition, Callees &callees)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_callees.find(definition, callees);
+}
+
+void ControlFlowGraphCache::insertCallees(const IndexedDeclaration &definition, const Callees &callees, const QList<IndexedString> &files)
+{
+    QMutexLocker locker(&m_mutex);
+    m_callees.insert(definition, callees, files);
+}
+
+bool ControlFlowGraphCache::functionInfo(const IndexedDeclaration &declaration, DUChainControlFlow::FunctionInfo &functionInfo)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_functionInfos.find(declaration, functionInfo);
+}
+
+void ControlFlowGraphCache::insertFunctionInfo(const IndexedDeclaration &declaration, const DUChainControlFlow::FunctionInfo &functionInfo, const QList<IndexedString> &files)
+{
+    QMutexLocker locker(&m_mutex);
+    m_functionInfos.insert(declaration, functionInfo, files);
+}
+
+void ControlFlowGraphCache::invalidate(const IndexedString &file)
+{
+    QMutexLocker locker(&m_mutex);
+    m_callees.invalidate(file);
+    m_functionInfos.invalidate(file);
+}
+
+void ControlFlowGraphCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_callees.clear();
+    m_functionInfos.clear();
+}
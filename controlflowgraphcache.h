@@ -0,0 +1,135 @@
+/***************************************************************************
+ *   Copyright 2026 KDevelop developers                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef CONTROLFLOWGRAPHCACHE_H
+#define CONTROLFLOWGRAPHCACHE_H
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QMutex>
+
+#include <language/duchain/use.h>
+#include <language/duchain/indexeddeclaration.h>
+#include <serialization/indexedstring.h>
+
+#include "duchaincontrolflow.h"
+
+using namespace KDevelop;
+
+/**
+ * Traversal results shared by every view and export of the plugin: the callees of each
+ * function definition and the label data of each function. Safe to query from the
+ * graph jobs concurrently. Entries are dropped when any file they were built from is
+ * reparsed and, beyond a fixed number of functions, least recently used first.
+ */
+class ControlFlowGraphCache
+{
+public:
+    typedef QList< QPair<IndexedDeclaration, Use> > Callees;
+
+    ControlFlowGraphCache();
+
+    bool callees(const IndexedDeclaration &definition, Callees &callees);
+    // Files are those of the definition and of every callee
+    void insertCallees(const IndexedDeclaration &definition, const Callees &callees, const QList<IndexedString> &files);
+
+    bool functionInfo(const IndexedDeclaration &declaration, DUChainControlFlow::FunctionInfo &functionInfo);
+    void insertFunctionInfo(const IndexedDeclaration &declaration, const DUChainControlFlow::FunctionInfo &functionInfo, const QList<IndexedString> &files);
+
+    void invalidate(const IndexedString &file);
+    void clear();
+private:
+    template <typename Value>
+    class Entries
+    {
+    public:
+        explicit Entries(int capacity) : m_capacity(capacity) {}
+
+        bool find(const IndexedDeclaration &key, Value &value)
+        {
+            typename QHash<IndexedDeclaration, Entry>::const_iterator entry = m_entries.constFind(key);
+            if (entry == m_entries.constEnd())
+                return false;
+            value = entry->value;
+            m_order.removeOne(key);
+            m_order << key;
+            return true;
+        }
+
+        void insert(const IndexedDeclaration &key, const Value &value, const QList<IndexedString> &files)
+        {
+            remove(key);
+            if (m_order.size() >= m_capacity)
+                remove(m_order.first());
+
+            Entry entry;
+            entry.value = value;
+            entry.files = files;
+            m_entries.insert(key, entry);
+            m_order << key;
+            foreach (const IndexedString &file, files)
+                if (!m_byFile.contains(file, key))
+                    m_byFile.insert(file, key);
+        }
+
+        void invalidate(const IndexedString &file)
+        {
+            foreach (const IndexedDeclaration &key, m_byFile.values(file))
+                remove(key);
+        }
+
+        void clear()
+        {
+            m_entries.clear();
+            m_order.clear();
+            m_byFile.clear();
+        }
+
+    private:
+        struct Entry
+        {
+            Value value;
+            QList<IndexedString> files;
+        };
+
+        void remove(const IndexedDeclaration &key)
+        {
+            typename QHash<IndexedDeclaration, Entry>::iterator entry = m_entries.find(key);
+            if (entry == m_entries.end())
+                return;
+            foreach (const IndexedString &file, entry->files)
+                m_byFile.remove(file, key);
+            m_order.removeOne(key);
+            m_entries.erase(entry);
+        }
+
+        int m_capacity;
+        QHash<IndexedDeclaration, Entry> m_entries;
+        // Least recently used first
+        QList<IndexedDeclaration> m_order;
+        QMultiHash<IndexedString, IndexedDeclaration> m_byFile;
+    };
+
+    QMutex m_mutex;
+    Entries<Callees> m_callees;
+    Entries<DUChainControlFlow::FunctionInfo> m_functionInfos;
+};
+
+#endif
@@ -0,0 +1,133 @@
+/***************************************************************************
+ *   Copyright 2026 KDevelop developers                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "controlflowgraphcallfilter.h"
+
+#include <interfaces/icore.h>
+#include <interfaces/iproject.h>
+#include <interfaces/iprojectcontroller.h>
+
+#include <language/duchain/declaration.h>
+#include <language/duchain/functiondefinition.h>
+
+ControlFlowGraphCallFilter::ControlFlowGraphCallFilter()
+: m_projectFilesOnly(false),
+  m_excludedAsLeaves(true)
+{
+}
+
+QStringList ControlFlowGraphCallFilter::defaultExcludedNamespaces()
+{
+    return QStringList() << "std::" << "__gnu_cxx::" << "boost::";
+}
+
+QStringList ControlFlowGraphCallFilter::defaultExcludedPaths()
+{
+    return QStringList() << "/usr/*" << "*/include/Qt*" << "*/moc_*" << "*.moc" << "*/ui_*.h" << "*/qrc_*";
+}
+
+void ControlFlowGraphCallFilter::setExcludedNamespaces(const QStringList &prefixes)
+{
+    m_excludedNamespaces.clear();
+    foreach (const QString &prefix, prefixes)
+        if (!prefix.trimmed().isEmpty())
+            m_excludedNamespaces << prefix.trimmed();
+}
+
+QStringList ControlFlowGraphCallFilter::excludedNamespaces() const
+{
+    return m_excludedNamespaces;
+}
+
+void ControlFlowGraphCallFilter::setExcludedPaths(const QStringList &globs)
+{
+    m_excludedPaths.clear();
+    foreach (const QString &glob, globs)
+        if (!glob.trimmed().isEmpty())
+            m_excludedPaths << QRegExp(glob.trimmed(), Qt::CaseSensitive, QRegExp::Wildcard);
+}
+
+QStringList ControlFlowGraphCallFilter::excludedPaths() const
+{
+    QStringList globs;
+    foreach (const QRegExp &pattern, m_excludedPaths)
+        globs << pattern.pattern();
+    return globs;
+}
+
+void ControlFlowGraphCallFilter::setProjectFilesOnly(bool projectFilesOnly)
+{
+    m_projectFilesOnly = projectFilesOnly;
+    m_projectFiles.clear();
+    if (m_projectFilesOnly)
+        foreach (IProject *project, ICore::self()->projectController()->projects())
+            m_projectFiles.unite(project->fileSet());
+}
+
+bool ControlFlowGraphCallFilter::projectFilesOnly() const
+{
+    return m_projectFilesOnly;
+}
+
+void ControlFlowGraphCallFilter::setExcludedAsLeaves(bool excludedAsLeaves)
+{
+    m_excludedAsLeaves = excludedAsLeaves;
+}
+
+bool ControlFlowGraphCallFilter::excludedAsLeaves() const
+{
+    return m_excludedAsLeaves;
+}
+
+bool ControlFlowGraphCallFilter::isEmpty() const
+{
+    return m_excludedNamespaces.isEmpty() && m_excludedPaths.isEmpty() && !m_projectFilesOnly;
+}
+
+ControlFlowGraphCallFilter::Action ControlFlowGraphCallFilter::action(Declaration *function) const
+{
+    if (!isExcluded(function))
+        return Expand;
+    return m_excludedAsLeaves ? Leaf : Hide;
+}
+
+bool ControlFlowGraphCallFilter::isExcluded(Declaration *function) const
+{
+    if (isEmpty())
+        return false;
+
+    QString qualifiedIdentifier = function->qualifiedIdentifier().toString();
+    foreach (const QString &prefix, m_excludedNamespaces)
+        if (qualifiedIdentifier.startsWith(prefix))
+            return true;
+
+    // Functions declared in a header but defined in the project still belong to it
+    FunctionDefinition *definition = FunctionDefinition::definition(function);
+    IndexedString url = function->url();
+    IndexedString definitionUrl = definition ? definition->url() : url;
+
+    if (m_projectFilesOnly && !m_projectFiles.contains(url) && !m_projectFiles.contains(definitionUrl))
+        return true;
+
+    QString path = url.str();
+    foreach (const QRegExp &pattern, m_excludedPaths)
+        if (pattern.exactMatch(path))
+            return true;
+    return false;
+}
@@ -0,0 +1,74 @@
+/***************************************************************************
+ *   Copyright 2026 KDevelop developers                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef CONTROLFLOWGRAPHCALLFILTER_H
+#define CONTROLFLOWGRAPHCALLFILTER_H
+
+#include <QSet>
+#include <QRegExp>
+#include <QStringList>
+
+#include <serialization/indexedstring.h>
+
+namespace KDevelop {
+    class Declaration;
+}
+using namespace KDevelop;
+
+/**
+ * Rules deciding, while the call graph is traversed, which called functions are expanded.
+ * Excluded functions are either drawn as leaves or left out of the graph altogether.
+ */
+class ControlFlowGraphCallFilter
+{
+public:
+    enum Action { Expand, Leaf, Hide };
+
+    ControlFlowGraphCallFilter();
+
+    // Standard library, Boost, Qt and system headers, and code generated by moc, uic and rcc
+    static QStringList defaultExcludedNamespaces();
+    static QStringList defaultExcludedPaths();
+
+    // Prefixes of qualified identifiers, such as "std::"
+    void setExcludedNamespaces(const QStringList &prefixes);
+    QStringList excludedNamespaces() const;
+    // Wildcard patterns matched against the whole path of the file declaring the function
+    void setExcludedPaths(const QStringList &globs);
+    QStringList excludedPaths() const;
+    // Snapshots the files of the projects currently open, so it must be called from the main thread
+    void setProjectFilesOnly(bool projectFilesOnly);
+    bool projectFilesOnly() const;
+    void setExcludedAsLeaves(bool excludedAsLeaves);
+    bool excludedAsLeaves() const;
+
+    bool isEmpty() const;
+    // The DUChain must be read locked
+    Action action(Declaration *function) const;
+private:
+    bool isExcluded(Declaration *function) const;
+
+    QStringList m_excludedNamespaces;
+    QList<QRegExp> m_excludedPaths;
+    bool m_projectFilesOnly;
+    QSet<IndexedString> m_projectFiles;
+    bool m_excludedAsLeaves;
+};
+
+#endif
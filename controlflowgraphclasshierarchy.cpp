@@ -0,0 +1,195 @@
+/***************************************************************************
+ *   Copyright 2026 KDevelop developers                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "controlflowgraphclasshierarchy.h"
+
+#include <QSet>
+
+#include <interfaces/icore.h>
+#include <interfaces/iproject.h>
+#include <interfaces/iprojectcontroller.h>
+
+#include <language/duchain/duchain.h>
+#include <language/duchain/ducontext.h>
+#include <language/duchain/duchainlock.h>
+#include <language/duchain/duchainutils.h>
+#include <language/duchain/topducontext.h>
+#include <language/duchain/classdeclaration.h>
+#include <language/duchain/classfunctiondeclaration.h>
+#include <language/duchain/types/structuretype.h>
+
+void ControlFlowGraphClassHierarchy::update()
+{
+    QMutexLocker updateLocker(&m_updateMutex);
+
+    // Projects are marked first, so that files reparsed while they are walked are reindexed next time
+    QList<IProject *> projects;
+    m_mutex.lock();
+    foreach (IProject *project, ICore::self()->projectController()->projects())
+        if (!m_indexedProjects.contains(project->name()))
+        {
+            m_indexedProjects.insert(project->name());
+            projects << project;
+        }
+    QSet<IndexedString> staleFiles = m_staleFiles;
+    m_staleFiles.clear();
+    m_mutex.unlock();
+
+    foreach (IProject *project, projects)
+        indexProject(project);
+
+    foreach (const IndexedString &file, staleFiles)
+    {
+        DUChainReadLocker lock(DUChain::lock());
+        indexFile(DUChainUtils::standardContextForUrl(file.toUrl()));
+    }
+}
+
+void ControlFlowGraphClassHierarchy::invalidateFile(const IndexedString &file)
+{
+    // Before the first update there is nothing to keep up to date
+    QMutexLocker locker(&m_mutex);
+    if (!m_indexedProjects.isEmpty())
+        m_staleFiles.insert(file);
+}
+
+void ControlFlowGraphClassHierarchy::removeProject(IProject *project)
+{
+    foreach (const IndexedString &file, project->fileSet())
+        removeFile(file);
+    QMutexLocker locker(&m_mutex);
+    m_indexedProjects.remove(project->name());
+}
+
+void ControlFlowGraphClassHierarchy::indexFile(TopDUContext *topContext)
+{
+    if (!topContext)
+        return;
+
+    QList<Inheritance> inheritances;
+    collectInheritances(topContext, inheritances);
+
+    IndexedString file = topContext->url();
+    removeFile(file);
+
+    QMutexLocker locker(&m_mutex);
+    foreach (const Inheritance &inheritance, inheritances)
+    {
+        m_derivedClasses.insert(inheritance.first, inheritance.second);
+        m_inheritancesByFile.insert(file, inheritance);
+    }
+}
+
+void ControlFlowGraphClassHierarchy::indexProject(IProject *project)
+{
+    // Files not parsed yet are indexed when their parse jobs finish
+    foreach (const IndexedString &file, project->fileSet())
+    {
+        DUChainReadLocker lock(DUChain::lock());
+        indexFile(DUChainUtils::standardContextForUrl(file.toUrl()));
+    }
+}
+
+void ControlFlowGraphClassHierarchy::collectInheritances(DUContext *context, QList<Inheritance> &inheritances)
+{
+    foreach (Declaration *declaration, context->localDeclarations())
+    {
+        ClassDeclaration *classDeclaration = dynamic_cast<ClassDeclaration *>(declaration);
+        if (!classDeclaration)
+            continue;
+
+        for (uint i = 0; i < classDeclaration->baseClassesSize(); ++i)
+        {
+            StructureType::Ptr baseClass = classDeclaration->baseClasses()[i].baseClass.abstractType().cast<StructureType>();
+            if (baseClass)
+                inheritances << Inheritance(IndexedQualifiedIdentifier(baseClass->qualifiedIdentifier()), IndexedDeclaration(classDeclaration));
+        }
+    }
+
+    // Nested classes and classes inside namespaces
+    foreach (DUContext *child, context->childContexts())
+        if (child->type() == DUContext::Namespace || child->type() == DUContext::Class)
+            collectInheritances(child, inheritances);
+}
+
+QList<Declaration *> ControlFlowGraphClassHierarchy::overrides(Declaration *function)
+{
+    QList<Declaration *> overrides;
+
+    // Calls usually refer to the declaration inside the class body
+    if (function->isDefinition())
+    {
+        Declaration *declaration = DUChainUtils::declarationForDefinition(function, function->topContext());
+        if (declaration)
+            function = declaration;
+    }
+
+    ClassFunctionDeclaration *classFunction = dynamic_cast<ClassFunctionDeclaration *>(function);
+    if (!classFunction || !classFunction->isVirtual() || !function->context() ||
+        function->context()->type() != DUContext::Class || !function->context()->owner())
+        return overrides;
+
+    // Walk down the hierarchy breadth first, an override may be further overridden
+    QList<IndexedQualifiedIdentifier> pendingClasses;
+    QSet<IndexedQualifiedIdentifier> visitedClasses;
+    pendingClasses << IndexedQualifiedIdentifier(function->context()->owner()->qualifiedIdentifier());
+    while (!pendingClasses.isEmpty())
+    {
+        IndexedQualifiedIdentifier baseClass = pendingClasses.takeFirst();
+        if (visitedClasses.contains(baseClass))
+            continue;
+        visitedClasses.insert(baseClass);
+
+        m_mutex.lock();
+        QList<IndexedDeclaration> derivedClasses = m_derivedClasses.values(baseClass);
+        m_mutex.unlock();
+
+        foreach (const IndexedDeclaration &iderivedClass, derivedClasses)
+        {
+            Declaration *derivedClass = iderivedClass.data();
+            if (!derivedClass || !derivedClass->internalContext())
+                continue;
+
+            foreach (Declaration *declaration, derivedClass->internalContext()->findLocalDeclarations(function->identifier(), CursorInRevision::invalid(),
+                                                                                                   0, function->abstractType()))
+                if (declaration->isFunctionDeclaration() && !overrides.contains(declaration))
+                    overrides << declaration;
+
+            pendingClasses << IndexedQualifiedIdentifier(derivedClass->qualifiedIdentifier());
+        }
+    }
+    return overrides;
+}
+
+void ControlFlowGraphClassHierarchy::removeFile(const IndexedString &file)
+{
+    QMutexLocker locker(&m_mutex);
+    foreach (const Inheritance &inheritance, m_inheritancesByFile.values(file))
+        m_derivedClasses.remove(inheritance.first, inheritance.second);
+    m_inheritancesByFile.remove(file);
+}
+
+void ControlFlowGraphClassHierarchy::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_derivedClasses.clear();
+    m_inheritancesByFile.clear();
+    m_indexedProjects.clear();
+    m_staleFiles.clear();
+}
@@ -0,0 +1,77 @@
+/***************************************************************************
+ *   Copyright 2026 KDevelop developers                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef CONTROLFLOWGRAPHCLASSHIERARCHY_H
+#define CONTROLFLOWGRAPHCLASSHIERARCHY_H
+
+#include <QList>
+#include <QPair>
+#include <QSet>
+#include <QMutex>
+#include <QMultiHash>
+
+#include <language/duchain/indexeddeclaration.h>
+#include <serialization/indexedstring.h>
+#include <language/duchain/identifier.h>
+
+namespace KDevelop {
+    class IProject;
+    class DUContext;
+    class Declaration;
+    class TopDUContext;
+}
+using namespace KDevelop;
+
+/**
+ * Index from each base class to the classes directly derived from it, used to expand
+ * virtual calls to every known override. Nothing is indexed until a graph job expanding
+ * overrides calls update, which walks the open projects once and afterwards only the
+ * files reparsed since. Safe to query from the graph jobs.
+ */
+class ControlFlowGraphClassHierarchy
+{
+public:
+    // Called from the graph jobs, the DUChain must not be locked by the caller
+    void update();
+    // The DUChain must be read locked by the caller
+    QList<Declaration *> overrides(Declaration *function);
+
+    // Reparsed files are only reindexed by the next update
+    void invalidateFile(const IndexedString &file);
+    void removeProject(IProject *project);
+    void clear();
+private:
+    typedef QPair<IndexedQualifiedIdentifier, IndexedDeclaration> Inheritance;
+
+    void indexFile(TopDUContext *topContext);
+    void indexProject(IProject *project);
+    void removeFile(const IndexedString &file);
+    void collectInheritances(DUContext *context, QList<Inheritance> &inheritances);
+
+    // Serializes updates, so that a project is walked by a single job
+    QMutex m_updateMutex;
+    QSet<QString> m_indexedProjects;
+    QSet<IndexedString> m_staleFiles;
+
+    QMutex m_mutex;
+    QMultiHash<IndexedQualifiedIdentifier, IndexedDeclaration> m_derivedClasses;
+    QMultiHash<IndexedString, Inheritance> m_inheritancesByFile;
+};
+
+#endif
@@ -19,12 +19,17 @@
 
 #include "controlflowgraphfiledialog.h"
 
+#include <QCheckBox>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QLabel>
 #include <QRadioButton>
 
 #include <interfaces/icore.h>
 #include <interfaces/iprojectcontroller.h>
 
 #include "ui_controlflowgraphexportconfiguration.h"
+#include "dotcontrolflowgraph.h"
 
 using namespace KDevelop;
 
@@ -47,6 +52,21 @@ ControlFlowGraphFileDialog::ControlFlowGraphFileDialog(QWidget *parent, OpeningM
     setConfirmOverwrite(true);
     setFileMode(QFileDialog::AnyFile);
 
+    // Additional formats are rendered from the same layout as the selected file
+    QWidget *formatsWidget = new QWidget;
+    QHBoxLayout *formatsLayout = new QHBoxLayout(formatsWidget);
+    formatsLayout->setContentsMargins(0, 0, 0, 0);
+    formatsLayout->addWidget(new QLabel(i18n("Also export as:")));
+    foreach (const QString &format, QStringList() << "png" << "svg" << "pdf" << "dot")
+    {
+        QCheckBox *checkBox = new QCheckBox(format.toUpper());
+        checkBox->setObjectName(format);
+        formatsLayout->addWidget(checkBox);
+        m_additionalFormatCheckBoxes << checkBox;
+    }
+    formatsLayout->addStretch();
+    layout()->addWidget(formatsWidget);
+
     if (mode != NoConfigurationButtons)
     {
         m_configurationWidget = new Ui::ControlFlowGraphExportConfiguration;
@@ -61,8 +81,15 @@ ControlFlowGraphFileDialog::ControlFlowGraphFileDialog(QWidget *parent, OpeningM
         m_configurationWidget->clusteringProjectCheckBox->setIcon(QIcon::fromTheme("folder-development"));
         m_configurationWidget->limitMaxLevelCheckBox->setIcon(QIcon::fromTheme("zoom-fit-height"));
         m_configurationWidget->drawIncomingArcsCheckBox->setIcon(QIcon::fromTheme("draw-arrow-down"));
+        m_configurationWidget->expandOverridesCheckBox->setIcon(QIcon::fromTheme("code-class"));
+        m_configurationWidget->externalLayoutCheckBox->setIcon(QIcon::fromTheme("system-run"));
+        m_configurationWidget->externalLayoutCheckBox->setEnabled(DotControlFlowGraph::externalLayoutAvailable());
         m_configurationWidget->useFolderNameCheckBox->setIcon(QIcon::fromTheme("folder-favorites"));
         m_configurationWidget->useShortNamesCheckBox->setIcon(QIcon::fromTheme("application-x-arc"));
+        m_configurationWidget->projectFilesOnlyCheckBox->setIcon(QIcon::fromTheme("folder-development"));
+
+        m_configurationWidget->excludedNamespacesLineEdit->setText(ControlFlowGraphCallFilter::defaultExcludedNamespaces().join(", "));
+        m_configurationWidget->excludedPathsLineEdit->setText(ControlFlowGraphCallFilter::defaultExcludedPaths().join(", "));
 
         connect(m_configurationWidget->controlFlowFunctionRadioButton, SIGNAL(toggled(bool)), SLOT(setControlFlowMode(bool)));
         connect(m_configurationWidget->controlFlowClassRadioButton, SIGNAL(toggled(bool)), SLOT(setControlFlowMode(bool)));
@@ -73,11 +100,13 @@ ControlFlowGraphFileDialog::ControlFlowGraphFileDialog(QWidget *parent, OpeningM
         connect(m_configurationWidget->clusteringProjectCheckBox, SIGNAL(stateChanged(int)), SLOT(setClusteringModes(int)));
 
         connect(m_configurationWidget->limitMaxLevelCheckBox, SIGNAL(stateChanged(int)), SLOT(slotLimitMaxLevelChanged(int)));
+        connect(this, SIGNAL(accepted()), SLOT(updateCallFilter()));
 
         if (ICore::self()->projectController()->projectCount() > 0)
         {
             m_configurationWidget->clusteringProjectCheckBox->setEnabled(true);
             m_configurationWidget->useFolderNameCheckBox->setEnabled(true);
+            m_configurationWidget->projectFilesOnlyCheckBox->setEnabled(true);
         }
 
         layout()->addWidget(widget);
@@ -135,6 +164,54 @@ bool ControlFlowGraphFileDialog::drawIncomingArcs() const
     return m_configurationWidget->drawIncomingArcsCheckBox->isChecked();
 }
 
+bool ControlFlowGraphFileDialog::expandOverrides() const
+{
+    return m_configurationWidget->expandOverridesCheckBox->isChecked();
+}
+
+bool ControlFlowGraphFileDialog::externalLayout() const
+{
+    return m_configurationWidget->externalLayoutCheckBox->isEnabled() && m_configurationWidget->externalLayoutCheckBox->isChecked();
+}
+
+ControlFlowGraphCallFilter ControlFlowGraphFileDialog::callFilter() const
+{
+    return m_callFilter;
+}
+
+void ControlFlowGraphFileDialog::updateCallFilter()
+{
+    // Exports read the filter from their job threads, so it is built once the dialog is accepted
+    m_callFilter = ControlFlowGraphCallFilter();
+    if (m_configurationWidget->exclusionsGroupBox->isChecked())
+    {
+        m_callFilter.setExcludedNamespaces(m_configurationWidget->excludedNamespacesLineEdit->text().split(','));
+        m_callFilter.setExcludedPaths(m_configurationWidget->excludedPathsLineEdit->text().split(','));
+        m_callFilter.setProjectFilesOnly(m_configurationWidget->projectFilesOnlyCheckBox->isChecked());
+        m_callFilter.setExcludedAsLeaves(m_configurationWidget->excludedAsLeavesCheckBox->isChecked());
+    }
+}
+
+QStringList ControlFlowGraphFileDialog::exportFileNames(const QString &baseName) const
+{
+    QStringList fileNames;
+    if (selectedFiles().isEmpty())
+        return fileNames;
+
+    // A given base name replaces the one of the selected file, keeping its folder and format
+    QFileInfo fileInfo(selectedFiles()[0]);
+    QString filePath = fileInfo.path() + '/' + (baseName.isEmpty() ? fileInfo.completeBaseName() : baseName);
+    fileNames << (baseName.isEmpty() ? selectedFiles()[0] : filePath + '.' + fileInfo.suffix());
+
+    foreach (QCheckBox *checkBox, m_additionalFormatCheckBoxes)
+    {
+        QString fileName = filePath + '.' + checkBox->objectName();
+        if (checkBox->isChecked() && !fileNames.contains(fileName))
+            fileNames << fileName;
+    }
+    return fileNames;
+}
+
 void ControlFlowGraphFileDialog::setControlFlowMode(bool checked)
 {
     if (checked)
@@ -21,9 +21,12 @@
 #define CONTROLFLOWGRAPHFILEDIALOG_H
 
 #include <QFileDialog>
+#include <QList>
 
 #include "duchaincontrolflow.h"
 
+class QCheckBox;
+
 namespace Ui
 {
     class ControlFlowGraphExportConfiguration;
@@ -43,12 +46,20 @@ public:
     bool useFolderName() const;
     bool useShortNames() const;
     bool drawIncomingArcs() const;    
+    bool expandOverrides() const;
+    bool externalLayout() const;
+    ControlFlowGraphCallFilter callFilter() const;
+    QStringList exportFileNames(const QString &baseName = QString()) const;
 public Q_SLOTS:
     void setControlFlowMode(bool);
     void setClusteringModes(int);
     void slotLimitMaxLevelChanged(int state);
+private Q_SLOTS:
+    void updateCallFilter();
 private:
     Ui::ControlFlowGraphExportConfiguration *m_configurationWidget;
+    QList<QCheckBox *> m_additionalFormatCheckBoxes;
+    ControlFlowGraphCallFilter m_callFilter;
 };
 
 #endif
@@ -0,0 +1,81 @@
+/***************************************************************************
+ *   Copyright 2026 KDevelop developers                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "controlflowgraphlinecache.h"
+
+#include <QFile>
+#include <QTextStream>
+
+namespace {
+    const int MAX_CACHED_FILES = 64;
+}
+
+Q_GLOBAL_STATIC(ControlFlowGraphLineCache, lineCache)
+
+ControlFlowGraphLineCache *ControlFlowGraphLineCache::self()
+{
+    return lineCache();
+}
+
+QStringList ControlFlowGraphLineCache::lines(const IndexedString &file)
+{
+    m_mutex.lock();
+    if (m_lines.contains(file))
+    {
+        QStringList lines = m_lines[file];
+        m_mutex.unlock();
+        return lines;
+    }
+    m_mutex.unlock();
+
+    // Read without holding the lock, other hovers may be served meanwhile
+    QStringList lines;
+    QFile sourceFile(file.str());
+    if (sourceFile.open(QIODevice::ReadOnly | QIODevice::Text))
+        lines = QTextStream(&sourceFile).readAll().split('\n');
+
+    insert(file, lines);
+    return lines;
+}
+
+bool ControlFlowGraphLineCache::contains(const IndexedString &file)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_lines.contains(file);
+}
+
+void ControlFlowGraphLineCache::insert(const IndexedString &file, const QStringList &lines)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_lines.contains(file))
+    {
+        // Forget the oldest files first
+        if (m_files.size() >= MAX_CACHED_FILES)
+            m_lines.remove(m_files.takeFirst());
+        m_files << file;
+    }
+    m_lines[file] = lines;
+}
+
+void ControlFlowGraphLineCache::invalidate(const IndexedString &file)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_lines.remove(file))
+        m_files.removeAll(file);
+}
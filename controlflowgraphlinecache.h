@@ -0,0 +1,51 @@
+/***************************************************************************
+ *   Copyright 2026 KDevelop developers                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef CONTROLFLOWGRAPHLINECACHE_H
+#define CONTROLFLOWGRAPHLINECACHE_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QStringList>
+
+#include <serialization/indexedstring.h>
+
+using namespace KDevelop;
+
+/**
+ * Source lines of the files shown in edge tooltips, shared by all hovers.
+ * Safe to use from worker threads; files are read from disk at most once until invalidated.
+ */
+class ControlFlowGraphLineCache
+{
+public:
+    static ControlFlowGraphLineCache *self();
+
+    QStringList lines(const IndexedString &file);
+    bool contains(const IndexedString &file);
+    void insert(const IndexedString &file, const QStringList &lines);
+    void invalidate(const IndexedString &file);
+private:
+    QMutex m_mutex;
+    QHash<IndexedString, QStringList> m_lines;
+    QList<IndexedString> m_files;
+};
+
+#endif
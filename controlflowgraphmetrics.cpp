@@ -0,0 +1,213 @@
+/***************************************************************************
+ *   Copyright 2026 KDevelop developers                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "controlflowgraphmetrics.h"
+
+#include <QMap>
+#include <QThread>
+#include <QtConcurrentMap>
+
+#include <KLocalizedString>
+
+#include "controlflowgraphmetricsdialog.h"
+
+namespace {
+    // A shard is a range of callers for function metrics or a list of members for class metrics
+    struct Shard
+    {
+        QVector<int> sources;
+        bool grouped;
+        QVector<int> fanOut;
+        QVector<int> closure;
+    };
+
+    class ShardMetrics
+    {
+    public:
+        ShardMetrics(const ControlFlowGraphProjectIndex &index, const QVector<int> &classOf, const bool &abort)
+        : m_index(index), m_classOf(classOf), m_abort(abort)
+        {
+        }
+
+        void operator()(Shard &shard) const
+        {
+            // Stamps avoid clearing the visited set between sources
+            QVector<int> visited(m_index.size(), -1);
+            QVector<int> pending;
+            pending.reserve(m_index.size());
+
+            int groups = shard.grouped ? 1 : shard.sources.size();
+            for (int group = 0; group < groups && !m_abort; ++group)
+            {
+                pending.clear();
+                if (shard.grouped)
+                    foreach (int source, shard.sources)
+                    {
+                        visited[source] = group;
+                        pending << source;
+                    }
+                else
+                {
+                    visited[shard.sources[group]] = group;
+                    pending << shard.sources[group];
+                }
+
+                int classId = shard.grouped ? m_classOf[shard.sources.first()] : -1;
+                int fanOut = 0, closure = 0;
+                for (int i = 0; i < pending.size(); ++i)
+                {
+                    int caller = pending[i];
+                    bool direct = shard.grouped ? m_classOf[caller] == classId : i == 0;
+                    foreach (int callee, m_index.callees(caller))
+                    {
+                        if (visited[callee] == group)
+                            continue;
+                        visited[callee] = group;
+                        pending << callee;
+                        if (shard.grouped && m_classOf[callee] == classId)
+                            continue;
+                        if (direct)
+                            ++fanOut;
+                        ++closure;
+                    }
+                }
+                shard.fanOut << fanOut;
+                shard.closure << closure;
+            }
+        }
+    private:
+        const ControlFlowGraphProjectIndex &m_index;
+        const QVector<int> &m_classOf;
+        const bool &m_abort;
+    };
+}
+
+ControlFlowGraphMetrics::ControlFlowGraphMetrics(IProject *project)
+: m_index(project)
+{
+}
+
+QString ControlFlowGraphMetrics::description() const
+{
+    return i18n("Computing call metrics");
+}
+
+QDialog *ControlFlowGraphMetrics::resultDialog(QWidget *parent) const
+{
+    return new ControlFlowGraphMetricsDialog(*this, parent);
+}
+
+void ControlFlowGraphMetrics::analyze(DUChainControlFlow *duchainControlFlow, const bool &abort)
+{
+    m_index.build(duchainControlFlow, abort);
+    if (abort)
+        return;
+
+    int size = m_index.size();
+    QMap<QString, QVector<int> > members;
+    QVector<int> classOf(size, -1);
+    for (int id = 0; id < size; ++id)
+        if (!m_index.function(id).className.isEmpty())
+            members[m_index.function(id).className] << id;
+    int classId = 0;
+    foreach (const QVector<int> &ids, members)
+    {
+        foreach (int id, ids)
+            classOf[id] = classId;
+        ++classId;
+    }
+
+    // Several shards per thread keep workers busy when closure sizes are uneven
+    QList<Shard> shards;
+    int shardSize = qMax(1, size / (QThread::idealThreadCount() * 4));
+    for (int begin = 0; begin < size; begin += shardSize)
+    {
+        Shard shard;
+        shard.grouped = false;
+        for (int id = begin; id < qMin(size, begin + shardSize); ++id)
+            shard.sources << id;
+        shards << shard;
+    }
+    foreach (const QVector<int> &ids, members)
+    {
+        Shard shard;
+        shard.grouped = true;
+        shard.sources = ids;
+        shards << shard;
+    }
+    QtConcurrent::blockingMap(shards, ShardMetrics(m_index, classOf, abort));
+    if (abort)
+        return;
+
+    // Fan-in only needs one pass over the call edges
+    QVector<int> fanIn(size, 0);
+    QVector<int> classFanIn(members.size(), 0);
+    QVector<int> lastCaller(members.size(), -1);
+    for (int caller = 0; caller < size; ++caller)
+        foreach (int callee, m_index.callees(caller))
+        {
+            ++fanIn[callee];
+            int calleeClass = classOf[callee];
+            if (calleeClass >= 0 && calleeClass != classOf[caller] && lastCaller[calleeClass] != caller)
+            {
+                lastCaller[calleeClass] = caller;
+                ++classFanIn[calleeClass];
+            }
+        }
+
+    classId = 0;
+    QMap<QString, QVector<int> >::const_iterator member = members.constBegin();
+    foreach (const Shard &shard, shards)
+    {
+        for (int i = 0; i < shard.fanOut.size(); ++i)
+        {
+            const ControlFlowGraphProjectIndex::Function &function = m_index.function(shard.sources[i]);
+            Metrics metrics;
+            metrics.url = function.url;
+            metrics.line = function.line;
+            metrics.fanOut = shard.fanOut[i];
+            metrics.closure = shard.closure[i];
+            if (shard.grouped)
+            {
+                metrics.name = member.key();
+                metrics.functions = shard.sources.size();
+                metrics.fanIn = classFanIn[classId++];
+                m_classMetrics << metrics;
+                ++member;
+            }
+            else
+            {
+                metrics.name = function.name;
+                metrics.functions = 1;
+                metrics.fanIn = fanIn[shard.sources[i]];
+                m_functionMetrics << metrics;
+            }
+        }
+    }
+}
+
+const QList<ControlFlowGraphMetrics::Metrics> &ControlFlowGraphMetrics::functionMetrics() const
+{
+    return m_functionMetrics;
+}
+
+const QList<ControlFlowGraphMetrics::Metrics> &ControlFlowGraphMetrics::classMetrics() const
+{
+    return m_classMetrics;
+}
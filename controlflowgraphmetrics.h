@@ -0,0 +1,63 @@
+/***************************************************************************
+ *   Copyright 2026 KDevelop developers                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef CONTROLFLOWGRAPHMETRICS_H
+#define CONTROLFLOWGRAPHMETRICS_H
+
+#include <QUrl>
+#include <QList>
+#include <QVector>
+
+#include "controlflowgraphprojectindex.h"
+#include "controlflowgraphprojectanalysis.h"
+
+/**
+ * Fan-in, fan-out and transitive closure size of every function and class of a project.
+ * Closures are computed in parallel, each worker walking its own shard of the adjacency lists.
+ */
+class ControlFlowGraphMetrics : public ControlFlowGraphProjectAnalysis
+{
+public:
+    struct Metrics
+    {
+        QString name;
+        QUrl url;
+        int line;
+        int functions;
+        int fanIn;
+        int fanOut;
+        int closure;
+    };
+
+    ControlFlowGraphMetrics(IProject *project);
+
+    virtual QString description() const;
+    // Locks the DUChain by itself, file by file
+    virtual void analyze(DUChainControlFlow *duchainControlFlow, const bool &abort);
+    virtual QDialog *resultDialog(QWidget *parent) const;
+
+    const QList<Metrics> &functionMetrics() const;
+    const QList<Metrics> &classMetrics() const;
+private:
+    ControlFlowGraphProjectIndex m_index;
+    QList<Metrics> m_functionMetrics;
+    QList<Metrics> m_classMetrics;
+};
+
+#endif
@@ -0,0 +1,145 @@
+/***************************************************************************
+ *   Copyright 2026 KDevelop developers                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "controlflowgraphmetricsdialog.h"
+
+#include <QFile>
+#include <QTabWidget>
+#include <QTextStream>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+#include <QHeaderView>
+#include <QPushButton>
+#include <QFileDialog>
+#include <QDialogButtonBox>
+
+#include <KMessageBox>
+#include <KLocalizedString>
+#include <KTextEditor/Cursor>
+
+#include <interfaces/icore.h>
+#include <interfaces/idocumentcontroller.h>
+
+using namespace KDevelop;
+
+namespace {
+    enum { UrlRole = Qt::UserRole, LineRole };
+
+    QString csvField(const QString &field)
+    {
+        if (!field.contains(',') && !field.contains('"') && !field.contains('\n'))
+            return field;
+        return '"' + QString(field).replace('"', "\"\"") + '"';
+    }
+}
+
+ControlFlowGraphMetricsDialog::ControlFlowGraphMetricsDialog(const ControlFlowGraphMetrics &metrics, QWidget *parent)
+: QDialog(parent),
+  m_tabWidget(new QTabWidget(this))
+{
+    setWindowTitle(i18n("Call Metrics"));
+    setAttribute(Qt::WA_DeleteOnClose);
+
+    m_tabWidget->addTab(metricsTreeWidget(metrics.functionMetrics(), false), i18n("Functions (%1)", metrics.functionMetrics().size()));
+    m_tabWidget->addTab(metricsTreeWidget(metrics.classMetrics(), true), i18n("Classes (%1)", metrics.classMetrics().size()));
+
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close, this);
+    QPushButton *exportButton = buttonBox->addButton(i18n("Export as CSV..."), QDialogButtonBox::ActionRole);
+    connect(exportButton, SIGNAL(clicked()), SLOT(exportCsv()));
+    connect(buttonBox, SIGNAL(rejected()), SLOT(reject()));
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addWidget(m_tabWidget);
+    layout->addWidget(buttonBox);
+    resize(800, 600);
+}
+
+ControlFlowGraphMetricsDialog::~ControlFlowGraphMetricsDialog()
+{
+}
+
+QTreeWidget *ControlFlowGraphMetricsDialog::metricsTreeWidget(const QList<ControlFlowGraphMetrics::Metrics> &metrics, bool classes)
+{
+    QTreeWidget *treeWidget = new QTreeWidget(m_tabWidget);
+    treeWidget->setRootIsDecorated(false);
+    QStringList labels;
+    labels << (classes ? i18n("Class") : i18n("Function"));
+    if (classes)
+        labels << i18n("Functions");
+    labels << i18n("Fan-in") << i18n("Fan-out") << i18n("Transitive Closure") << i18n("Location");
+    treeWidget->setHeaderLabels(labels);
+    treeWidget->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+
+    // Numbers are stored as such so that columns sort numerically
+    foreach (const ControlFlowGraphMetrics::Metrics &entry, metrics)
+    {
+        QTreeWidgetItem *item = new QTreeWidgetItem(treeWidget);
+        int column = 0;
+        item->setText(column++, entry.name);
+        if (classes)
+            item->setData(column++, Qt::DisplayRole, entry.functions);
+        item->setData(column++, Qt::DisplayRole, entry.fanIn);
+        item->setData(column++, Qt::DisplayRole, entry.fanOut);
+        item->setData(column++, Qt::DisplayRole, entry.closure);
+        item->setText(column, QString("%1:%2").arg(entry.url.toLocalFile()).arg(entry.line + 1));
+        item->setData(0, UrlRole, entry.url);
+        item->setData(0, LineRole, entry.line);
+    }
+
+    treeWidget->setSortingEnabled(true);
+    treeWidget->sortByColumn(classes ? 2 : 1, Qt::DescendingOrder);
+    connect(treeWidget, SIGNAL(itemActivated(QTreeWidgetItem*,int)), SLOT(openDefinition(QTreeWidgetItem*)));
+    return treeWidget;
+}
+
+void ControlFlowGraphMetricsDialog::openDefinition(QTreeWidgetItem *item)
+{
+    QUrl url = item->data(0, UrlRole).toUrl();
+    if (url.isValid())
+        ICore::self()->documentController()->openDocument(url, KTextEditor::Cursor(item->data(0, LineRole).toInt(), 0));
+}
+
+void ControlFlowGraphMetricsDialog::exportCsv()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, i18n("Export Call Metrics"), QString(), i18n("CSV files (*.csv)"));
+    if (fileName.isEmpty())
+        return;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    {
+        KMessageBox::error(this, i18n("Could not write to %1", fileName));
+        return;
+    }
+
+    // Rows are written in the order currently shown
+    QTreeWidget *treeWidget = static_cast<QTreeWidget *>(m_tabWidget->currentWidget());
+    QTextStream stream(&file);
+    QStringList fields;
+    for (int column = 0; column < treeWidget->columnCount(); ++column)
+        fields << csvField(treeWidget->headerItem()->text(column));
+    stream << fields.join(",") << '\n';
+    for (int row = 0; row < treeWidget->topLevelItemCount(); ++row)
+    {
+        fields.clear();
+        for (int column = 0; column < treeWidget->columnCount(); ++column)
+            fields << csvField(treeWidget->topLevelItem(row)->text(column));
+        stream << fields.join(",") << '\n';
+    }
+}
@@ -0,0 +1,46 @@
+/***************************************************************************
+ *   Copyright 2026 KDevelop developers                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef CONTROLFLOWGRAPHMETRICSDIALOG_H
+#define CONTROLFLOWGRAPHMETRICSDIALOG_H
+
+#include <QDialog>
+
+#include "controlflowgraphmetrics.h"
+
+class QTabWidget;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+class ControlFlowGraphMetricsDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    ControlFlowGraphMetricsDialog(const ControlFlowGraphMetrics &metrics, QWidget *parent = 0);
+    virtual ~ControlFlowGraphMetricsDialog();
+private Q_SLOTS:
+    void openDefinition(QTreeWidgetItem *item);
+    void exportCsv();
+private:
+    QTreeWidget *metricsTreeWidget(const QList<ControlFlowGraphMetrics::Metrics> &metrics, bool classes);
+
+    QTabWidget *m_tabWidget;
+};
+
+#endif
@@ -19,19 +19,26 @@
 
 #include "controlflowgraphnavigationcontext.h"
 
+#include <QHash>
 #include <QTextDocument>
+#include <QUrl>
 
 #include <interfaces/icore.h>
 #include <interfaces/idocumentcontroller.h>
 
 #include <language/duchain/duchain.h>
 #include <language/duchain/duchainlock.h>
-#include <language/codegen/coderepresentation.h>
+
+#include "controlflowgraphlinecache.h"
 
 using namespace KDevelop;
 
+namespace {
+    const int USES_PER_PAGE = 100;
+}
+
 ControlFlowGraphNavigationContext::ControlFlowGraphNavigationContext(const QString &label, const ArcUses &arcUses, TopDUContextPointer topContext, AbstractNavigationContext *previousContext)
- : AbstractNavigationContext(topContext, previousContext), m_label(label), m_arcUses (arcUses)
+ : AbstractNavigationContext(topContext, previousContext), m_label(label), m_arcUses (arcUses), m_usesLoaded(false), m_page(0)
 {
 }
 
@@ -55,17 +62,25 @@ QString ControlFlowGraphNavigationContext::html(bool shorten)
         return "";
 
     modifyHtml() += importantHighlight(i18n("Uses of %1 from %2", nodes[1], nodes[0])) + "<hr>";
-    unsigned int i = m_arcUses.size()-1;
-    QPair<RangeInRevision, IndexedString> pair;
-    QListIterator< QPair<RangeInRevision, IndexedString> > iterator(m_arcUses);
-    iterator.toBack();
 
-    DUChainReadLocker lock(DUChain::lock());
-    while (iterator.hasPrevious())
+    // Use lines are built in a worker thread, long lists are shown a page at a time
+    if (!m_usesLoaded)
+        modifyHtml() += i18n("Loading uses...");
+    else
     {
-        pair = iterator.previous();
-        CodeRepresentation::Ptr code = createCodeRepresentation(pair.second);
-        modifyHtml() += "<a href='" + QString::number(i--) + "'>" + pair.second.toUrl().fileName() + " (" + QString::number(pair.first.start.line+1) + ")</a>: " + code->line(pair.first.start.line).trimmed().toHtmlEscaped() + "<br>";
+        int first = m_page * USES_PER_PAGE;
+        int last = qMin(first + USES_PER_PAGE, m_usesHtml.size());
+        for (int i = first; i < last; ++i)
+            modifyHtml() += m_usesHtml[i];
+
+        if (m_usesHtml.size() > USES_PER_PAGE)
+        {
+            modifyHtml() += "<hr>" + i18n("Uses %1-%2 of %3", first + 1, last, m_usesHtml.size());
+            if (m_page > 0)
+                modifyHtml() += " <a href='previous'>" + i18n("Previous") + "</a>";
+            if (last < m_usesHtml.size())
+                modifyHtml() += " <a href='next'>" + i18n("Next") + "</a>";
+        }
     }
 
     modifyHtml() += "</small></small></p></body></html>";
@@ -73,8 +88,49 @@ QString ControlFlowGraphNavigationContext::html(bool shorten)
     return currentHtml();
 }
 
+QStringList ControlFlowGraphNavigationContext::usesHtml(const ArcUses &arcUses)
+{
+    // Group uses by file, most recent first as before, so that each file is read only once
+    QList<IndexedString> files;
+    QHash<IndexedString, QList<int> > fileUses;
+    for (int i = arcUses.size()-1; i >= 0; --i)
+    {
+        if (!fileUses.contains(arcUses[i].second))
+            files << arcUses[i].second;
+        fileUses[arcUses[i].second] << i;
+    }
+
+    QStringList usesHtml;
+    foreach (const IndexedString &file, files)
+    {
+        QStringList lines = ControlFlowGraphLineCache::self()->lines(file);
+        QString fileName = file.toUrl().fileName();
+        foreach (int i, fileUses[file])
+        {
+            int line = arcUses[i].first.start.line;
+            usesHtml << "<a href='" + QString::number(i) + "'>" + fileName + " (" + QString::number(line+1) + ")</a>: " +
+                        (line < lines.size() ? lines[line].trimmed().toHtmlEscaped() : QString()) + "<br>";
+        }
+    }
+    return usesHtml;
+}
+
+void ControlFlowGraphNavigationContext::setUsesHtml(const QStringList &usesHtml)
+{
+    m_usesHtml = usesHtml;
+    m_usesLoaded = true;
+    emit contentsChanged();
+}
+
 void ControlFlowGraphNavigationContext::slotAnchorClicked(const QUrl &link)
 {
+    if (link.toString() == "next" || link.toString() == "previous")
+    {
+        m_page += (link.toString() == "next") ? 1 : -1;
+        emit contentsChanged();
+        return;
+    }
+
     int position = link.toString().toInt();
     QPair<RangeInRevision, IndexedString> pair = m_arcUses[position];
     DUChainReadLocker lock(DUChain::lock());
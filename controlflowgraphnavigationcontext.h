@@ -21,6 +21,7 @@
 #define CONTROLFLOWGRAPHNAVIGATIONCONTEXT_H
 
 #include <QString>
+#include <QStringList>
 
 #include <language/duchain/use.h>
 #include <language/duchain/navigation/abstractnavigationcontext.h>
@@ -38,11 +39,19 @@ public:
 
     virtual QString name() const;
     virtual QString html(bool shorten = false);
+
+    static QStringList usesHtml(const ArcUses &arcUses);
+    void setUsesHtml(const QStringList &usesHtml);
+Q_SIGNALS:
+    void contentsChanged();
 public Q_SLOTS:
     void slotAnchorClicked(const QUrl &link);
 private:
-    const QString &m_label;
+    QString m_label;
     QList< QPair<RangeInRevision, IndexedString> > m_arcUses;
+    QStringList m_usesHtml;
+    bool m_usesLoaded;
+    int m_page;
 };
 
 #endif
@@ -20,20 +20,59 @@
 #include "controlflowgraphnavigationwidget.h"
 
 #include <QTextBrowser>
+#include <QtConcurrentRun>
+
+#include <KTextEditor/Document>
+
+#include <interfaces/icore.h>
+#include <interfaces/idocument.h>
+#include <interfaces/idocumentcontroller.h>
 
 #include <language/duchain/topducontext.h>
 
+#include "controlflowgraphlinecache.h"
+
 using namespace KDevelop;
 
 ControlFlowGraphNavigationWidget::ControlFlowGraphNavigationWidget(const QString &label, const ControlFlowGraphNavigationContext::ArcUses &arcUses)
 {
     initBrowser(400);
     setFocusPolicy(Qt::NoFocus);
-    ControlFlowGraphNavigationContext *context = new ControlFlowGraphNavigationContext(label, arcUses, TopDUContextPointer(0));
-    setContext(NavigationContextPointer(context));
-    connect(m_browser, SIGNAL(anchorClicked(QUrl)), context, SLOT(slotAnchorClicked(QUrl)));
+    m_context = new ControlFlowGraphNavigationContext(label, arcUses, TopDUContextPointer(0));
+    setContext(NavigationContextPointer(m_context));
+    connect(m_browser, SIGNAL(anchorClicked(QUrl)), m_context, SLOT(slotAnchorClicked(QUrl)));
+    connect(m_context, SIGNAL(contentsChanged()), SLOT(contentsChanged()));
+
+    // Documents open in the editor may differ from disk, their text can only be read from the main thread
+    QPair<RangeInRevision, IndexedString> pair;
+    foreach (pair, arcUses)
+    {
+        if (ControlFlowGraphLineCache::self()->contains(pair.second))
+            continue;
+        IDocument *document = ICore::self()->documentController()->documentForUrl(pair.second.toUrl());
+        if (document && document->textDocument())
+            ControlFlowGraphLineCache::self()->insert(pair.second, document->textDocument()->textLines(document->textDocument()->documentRange()));
+    }
+
+    connect(&m_usesWatcher, SIGNAL(finished()), SLOT(usesLoaded()));
+    m_usesWatcher.setFuture(QtConcurrent::run(&ControlFlowGraphNavigationContext::usesHtml, arcUses));
 }
 
 ControlFlowGraphNavigationWidget::~ControlFlowGraphNavigationWidget()
 {
 }
+
+void ControlFlowGraphNavigationWidget::usesLoaded()
+{
+    m_context->setUsesHtml(m_usesWatcher.result());
+
+    // The tooltip was sized for the loading message, it grows to the uses now shown
+    updateGeometry();
+    if (parentWidget())
+        parentWidget()->resize(sizeHint() + QSize(10, 10));
+}
+
+void ControlFlowGraphNavigationWidget::contentsChanged()
+{
+    update();
+}
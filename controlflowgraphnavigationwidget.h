@@ -21,6 +21,7 @@
 #define CONTROLFLOWGRAPHNAVIGATIONWIDGET_H
 
 #include <QString>
+#include <QFutureWatcher>
 
 #include <language/duchain/navigation/abstractnavigationwidget.h>
 #include <language/duchain/use.h>
@@ -35,6 +36,12 @@ class ControlFlowGraphNavigationWidget : public AbstractNavigationWidget
 public:
     ControlFlowGraphNavigationWidget(const QString &label, const ControlFlowGraphNavigationContext::ArcUses &arcUses);
     virtual ~ControlFlowGraphNavigationWidget();
+private Q_SLOTS:
+    void usesLoaded();
+    void contentsChanged();
+private:
+    ControlFlowGraphNavigationContext *m_context;
+    QFutureWatcher<QStringList> m_usesWatcher;
 };
 
 #endif
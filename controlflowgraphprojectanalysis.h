@@ -0,0 +1,44 @@
+/***************************************************************************
+ *   Copyright 2026 KDevelop developers                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef CONTROLFLOWGRAPHPROJECTANALYSIS_H
+#define CONTROLFLOWGRAPHPROJECTANALYSIS_H
+
+#include <QString>
+
+class QDialog;
+class QWidget;
+class DUChainControlFlow;
+
+/**
+ * Whole-project analysis run by the plugin in a background job, whose results are shown in a dialog.
+ */
+class ControlFlowGraphProjectAnalysis
+{
+public:
+    virtual ~ControlFlowGraphProjectAnalysis() {}
+
+    // Status message shown while the analysis runs
+    virtual QString description() const = 0;
+    // Locks the DUChain by itself
+    virtual void analyze(DUChainControlFlow *duchainControlFlow, const bool &abort) = 0;
+    virtual QDialog *resultDialog(QWidget *parent) const = 0;
+};
+
+#endif
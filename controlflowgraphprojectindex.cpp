@@ -0,0 +1,143 @@
+/***************************************************************************
+ *   Copyright 2026 KDevelop developers                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "controlflowgraphprojectindex.h"
+
+#include <QFileInfo>
+
+#include <interfaces/iproject.h>
+
+#include <language/duchain/duchain.h>
+#include <language/duchain/ducontext.h>
+#include <language/duchain/declaration.h>
+#include <language/duchain/duchainlock.h>
+#include <language/duchain/duchainutils.h>
+#include <language/duchain/topducontext.h>
+#include <language/duchain/types/functiontype.h>
+#include <language/duchain/classfunctiondeclaration.h>
+
+#include "duchaincontrolflow.h"
+
+ControlFlowGraphProjectIndex::ControlFlowGraphProjectIndex(IProject *project)
+: m_files(project->fileSet().toList())
+{
+}
+
+void ControlFlowGraphProjectIndex::build(DUChainControlFlow *duchainControlFlow, const bool &abort)
+{
+    // Dense IDs for every function defined in the project
+    foreach (const IndexedString &file, m_files)
+    {
+        if (abort)
+            return;
+        DUChainReadLocker lock(DUChain::lock());
+        TopDUContext *topContext = DUChainUtils::standardContextForUrl(file.toUrl());
+        if (topContext)
+            collectFunctions(topContext);
+    }
+
+    // Calls to functions defined elsewhere are left out
+    m_callees.resize(m_functions.size());
+    for (int id = 0; id < m_functions.size(); ++id)
+    {
+        if (abort)
+            return;
+        DUChainReadLocker lock(DUChain::lock());
+        foreach (const IndexedDeclaration &callee, duchainControlFlow->calledFunctions(m_functions[id].declaration))
+        {
+            int calleeId = m_ids.value(callee, -1);
+            if (calleeId >= 0 && !m_callees[id].contains(calleeId))
+                m_callees[id] << calleeId;
+        }
+    }
+}
+
+void ControlFlowGraphProjectIndex::collectFunctions(DUContext *context)
+{
+    foreach (Declaration *declaration, context->localDeclarations())
+    {
+        if (!declaration->isDefinition() || !declaration->type<FunctionType>() || !declaration->internalContext())
+            continue;
+
+        IndexedDeclaration identity = DUChainControlFlow::functionIdentity(declaration);
+        if (m_ids.contains(identity))
+            continue;
+
+        Declaration *identityDeclaration = identity.data();
+        ClassFunctionDeclaration *classFunction = dynamic_cast<ClassFunctionDeclaration *>(identityDeclaration);
+
+        Function function;
+        function.declaration = identity;
+        function.name = identityDeclaration->qualifiedIdentifier().toString();
+        function.className = (identityDeclaration->context()->type() == DUContext::Class && identityDeclaration->context()->owner()) ?
+                             identityDeclaration->context()->owner()->qualifiedIdentifier().toString() : QString();
+        function.url = declaration->url().toUrl();
+        function.line = declaration->range().start.line;
+        function.slot = classFunction && classFunction->isSlot();
+        function.exported = isExported(identityDeclaration);
+
+        m_ids.insert(identity, m_functions.size());
+        m_functions << function;
+    }
+
+    // Out of line definitions live in namespaces, inline ones in classes
+    foreach (DUContext *child, context->childContexts())
+        if (child->type() == DUContext::Namespace || child->type() == DUContext::Class)
+            collectFunctions(child);
+}
+
+int ControlFlowGraphProjectIndex::size() const
+{
+    return m_functions.size();
+}
+
+const ControlFlowGraphProjectIndex::Function &ControlFlowGraphProjectIndex::function(int id) const
+{
+    return m_functions[id];
+}
+
+const QVector<int> &ControlFlowGraphProjectIndex::callees(int id) const
+{
+    return m_callees[id];
+}
+
+int ControlFlowGraphProjectIndex::id(const IndexedDeclaration &declaration) const
+{
+    return m_ids.value(declaration, -1);
+}
+
+bool ControlFlowGraphProjectIndex::isExported(Declaration *declaration)
+{
+    // Functions only declared in a source file cannot be called from outside the project
+    QString suffix = QFileInfo(declaration->url().str()).suffix().toLower();
+    if (!suffix.isEmpty() && !suffix.startsWith('h'))
+        return false;
+
+    // Private members are only callable through the public interface of their class
+    ClassFunctionDeclaration *classFunction = dynamic_cast<ClassFunctionDeclaration *>(declaration);
+    if (classFunction && classFunction->accessPolicy() == Declaration::Private)
+        return false;
+
+    // Anonymous namespaces give internal linkage to everything inside them
+    for (DUContext *context = declaration->context(); context; context = context->parentContext())
+        if (context->type() == DUContext::Namespace && context->localScopeIdentifier().isEmpty())
+            return false;
+
+    return true;
+}
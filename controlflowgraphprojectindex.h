@@ -0,0 +1,77 @@
+/***************************************************************************
+ *   Copyright 2026 KDevelop developers                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef CONTROLFLOWGRAPHPROJECTINDEX_H
+#define CONTROLFLOWGRAPHPROJECTINDEX_H
+
+#include <QUrl>
+#include <QHash>
+#include <QVector>
+
+#include <language/duchain/indexeddeclaration.h>
+#include <serialization/indexedstring.h>
+
+namespace KDevelop {
+    class IProject;
+    class DUContext;
+    class Declaration;
+}
+using namespace KDevelop;
+
+class DUChainControlFlow;
+
+/**
+ * Call graph of every function defined in a project, with dense function IDs and
+ * adjacency lists restricted to the project. Built once by the project-wide analyses.
+ */
+class ControlFlowGraphProjectIndex
+{
+public:
+    struct Function
+    {
+        IndexedDeclaration declaration;
+        QString name;
+        QString className;
+        QUrl url;
+        int line;
+        bool slot;
+        // Declared in a project header with external linkage and not private
+        bool exported;
+    };
+
+    ControlFlowGraphProjectIndex(IProject *project);
+
+    // Locks the DUChain by itself, file by file and function by function
+    void build(DUChainControlFlow *duchainControlFlow, const bool &abort);
+
+    int size() const;
+    const Function &function(int id) const;
+    const QVector<int> &callees(int id) const;
+    int id(const IndexedDeclaration &declaration) const;
+private:
+    void collectFunctions(DUContext *context);
+    static bool isExported(Declaration *declaration);
+
+    QList<IndexedString> m_files;
+    QVector<Function> m_functions;
+    QVector< QVector<int> > m_callees;
+    QHash<IndexedDeclaration, int> m_ids;
+};
+
+#endif
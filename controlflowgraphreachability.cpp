@@ -0,0 +1,160 @@
+/***************************************************************************
+ *   Copyright 2026 KDevelop developers                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "controlflowgraphreachability.h"
+
+#include <QQueue>
+
+#include <KLocalizedString>
+
+#include "controlflowgraphreachabilitydialog.h"
+
+ControlFlowGraphReachability::ControlFlowGraphReachability(IProject *project, const QStringList &entryPoints, bool exportedSymbols)
+: m_index(project),
+  m_exportedSymbols(exportedSymbols),
+  m_words(1)
+{
+    foreach (const QString &entryPoint, entryPoints)
+        if (!entryPoint.trimmed().isEmpty())
+            m_entryPointPatterns << QRegExp(entryPoint.trimmed(), Qt::CaseSensitive, QRegExp::Wildcard);
+}
+
+QString ControlFlowGraphReachability::description() const
+{
+    return i18n("Analyzing function reachability");
+}
+
+QDialog *ControlFlowGraphReachability::resultDialog(QWidget *parent) const
+{
+    return new ControlFlowGraphReachabilityDialog(*this, parent);
+}
+
+void ControlFlowGraphReachability::analyze(DUChainControlFlow *duchainControlFlow, const bool &abort)
+{
+    m_index.build(duchainControlFlow, abort);
+    if (abort)
+        return;
+
+    for (int id = 0; id < m_index.size(); ++id)
+        if (isEntryPoint(m_index.function(id)))
+            m_entryPoints << id;
+
+    // Seed one bit per entry point and propagate whole words along the call edges until nothing changes
+    m_words = qMax(1, (m_entryPoints.size() + 63) / 64);
+    m_reachedBy.fill(0, m_index.size() * m_words);
+    QQueue<int> pending;
+    QVector<bool> queued(m_index.size(), false);
+    for (int i = 0; i < m_entryPoints.size(); ++i)
+    {
+        int id = m_entryPoints[i];
+        m_reachedBy[id * m_words + i / 64] |= quint64(1) << (i % 64);
+        if (!queued[id])
+        {
+            queued[id] = true;
+            pending.enqueue(id);
+        }
+    }
+
+    while (!pending.isEmpty() && !abort)
+    {
+        int caller = pending.dequeue();
+        queued[caller] = false;
+        foreach (int callee, m_index.callees(caller))
+        {
+            bool changed = false;
+            for (int word = 0; word < m_words; ++word)
+            {
+                quint64 reachedBy = m_reachedBy[callee * m_words + word] | m_reachedBy[caller * m_words + word];
+                if (reachedBy != m_reachedBy[callee * m_words + word])
+                {
+                    m_reachedBy[callee * m_words + word] = reachedBy;
+                    changed = true;
+                }
+            }
+            if (changed && !queued[callee])
+            {
+                queued[callee] = true;
+                pending.enqueue(callee);
+            }
+        }
+    }
+}
+
+bool ControlFlowGraphReachability::isEntryPoint(const Function &function) const
+{
+    if (function.slot || (m_exportedSymbols && function.exported))
+        return true;
+
+    foreach (const QRegExp &pattern, m_entryPointPatterns)
+        if (pattern.exactMatch(function.name))
+            return true;
+    return false;
+}
+
+bool ControlFlowGraphReachability::isReachable(int id) const
+{
+    for (int word = 0; word < m_words; ++word)
+        if (m_reachedBy.value(id * m_words + word))
+            return true;
+    return false;
+}
+
+int ControlFlowGraphReachability::functionCount() const
+{
+    return m_index.size();
+}
+
+QList<ControlFlowGraphReachability::Function> ControlFlowGraphReachability::entryPoints() const
+{
+    QList<Function> functions;
+    foreach (int id, m_entryPoints)
+        functions << m_index.function(id);
+    return functions;
+}
+
+QList<ControlFlowGraphReachability::Function> ControlFlowGraphReachability::reachableFunctions() const
+{
+    QList<Function> functions;
+    for (int id = 0; id < m_index.size(); ++id)
+        if (isReachable(id))
+            functions << m_index.function(id);
+    return functions;
+}
+
+QList<ControlFlowGraphReachability::Function> ControlFlowGraphReachability::unreachableFunctions() const
+{
+    QList<Function> functions;
+    for (int id = 0; id < m_index.size(); ++id)
+        if (!isReachable(id))
+            functions << m_index.function(id);
+    return functions;
+}
+
+QStringList ControlFlowGraphReachability::reachedFrom(const Function &function) const
+{
+    QStringList names;
+    int id = m_index.id(function.declaration);
+    if (id < 0)
+        return names;
+
+    for (int i = 0; i < m_entryPoints.size(); ++i)
+        if (m_reachedBy.value(id * m_words + i / 64) & (quint64(1) << (i % 64)))
+            names << m_index.function(m_entryPoints[i]).name;
+    return names;
+}
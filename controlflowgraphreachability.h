@@ -0,0 +1,68 @@
+/***************************************************************************
+ *   Copyright 2026 KDevelop developers                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef CONTROLFLOWGRAPHREACHABILITY_H
+#define CONTROLFLOWGRAPHREACHABILITY_H
+
+#include <QRegExp>
+#include <QVector>
+#include <QStringList>
+
+#include "controlflowgraphprojectindex.h"
+#include "controlflowgraphprojectanalysis.h"
+
+/**
+ * Marks every function of a project reachable from a set of entry points. Functions get
+ * dense IDs and each of them carries one bit per entry point, so the whole closure is
+ * computed by propagating 64 entry points at a time along the call edges.
+ */
+class ControlFlowGraphReachability : public ControlFlowGraphProjectAnalysis
+{
+public:
+    typedef ControlFlowGraphProjectIndex::Function Function;
+
+    // Entry points are matched against qualified identifiers, wildcards allowed; Qt slots always are,
+    // functions exported by the project headers too when exportedSymbols is set
+    ControlFlowGraphReachability(IProject *project, const QStringList &entryPoints, bool exportedSymbols);
+
+    virtual QString description() const;
+    // Locks the DUChain by itself, file by file
+    virtual void analyze(DUChainControlFlow *duchainControlFlow, const bool &abort);
+    virtual QDialog *resultDialog(QWidget *parent) const;
+
+    int functionCount() const;
+    QList<Function> entryPoints() const;
+    QList<Function> reachableFunctions() const;
+    QList<Function> unreachableFunctions() const;
+    QStringList reachedFrom(const Function &function) const;
+private:
+    bool isEntryPoint(const Function &function) const;
+    bool isReachable(int id) const;
+
+    ControlFlowGraphProjectIndex m_index;
+    QList<QRegExp> m_entryPointPatterns;
+    bool m_exportedSymbols;
+
+    QVector<int> m_entryPoints;
+    // m_words bits per function, bit i is set when entry point i reaches the function
+    QVector<quint64> m_reachedBy;
+    int m_words;
+};
+
+#endif
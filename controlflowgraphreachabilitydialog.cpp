@@ -0,0 +1,109 @@
+/***************************************************************************
+ *   Copyright 2026 KDevelop developers                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "controlflowgraphreachabilitydialog.h"
+
+#include <QLabel>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+#include <QHeaderView>
+#include <QDialogButtonBox>
+
+#include <KLocalizedString>
+#include <KTextEditor/Cursor>
+
+#include <interfaces/icore.h>
+#include <interfaces/idocumentcontroller.h>
+
+#include "controlflowgraphreachability.h"
+
+using namespace KDevelop;
+
+namespace {
+    enum { UrlRole = Qt::UserRole, LineRole };
+
+    QTreeWidgetItem *functionItem(QTreeWidgetItem *parent, const ControlFlowGraphReachability::Function &function, const QString &reachedFrom = QString())
+    {
+        QTreeWidgetItem *item = new QTreeWidgetItem(parent, QStringList() << function.name
+                                                    << QString("%1:%2").arg(function.url.toLocalFile()).arg(function.line + 1)
+                                                    << reachedFrom);
+        item->setData(0, UrlRole, function.url);
+        item->setData(0, LineRole, function.line);
+        return item;
+    }
+}
+
+ControlFlowGraphReachabilityDialog::ControlFlowGraphReachabilityDialog(const ControlFlowGraphReachability &reachability, QWidget *parent)
+: QDialog(parent),
+  m_functionsTreeWidget(new QTreeWidget(this))
+{
+    setWindowTitle(i18n("Function Reachability"));
+    setAttribute(Qt::WA_DeleteOnClose);
+
+    QList<ControlFlowGraphReachability::Function> entryPoints = reachability.entryPoints();
+    QList<ControlFlowGraphReachability::Function> reachable = reachability.reachableFunctions();
+    QList<ControlFlowGraphReachability::Function> unreachable = reachability.unreachableFunctions();
+
+    QLabel *summaryLabel = new QLabel(i18n("%1 of %2 functions are not reachable from the %3 entry points.",
+                                           unreachable.size(), reachability.functionCount(), entryPoints.size()), this);
+
+    m_functionsTreeWidget->setHeaderLabels(QStringList() << i18n("Function") << i18n("Location") << i18n("Reached From"));
+    m_functionsTreeWidget->setSortingEnabled(true);
+    m_functionsTreeWidget->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+
+    QTreeWidgetItem *unreachableItem = new QTreeWidgetItem(m_functionsTreeWidget, QStringList() << i18n("Unreachable (%1)", unreachable.size()));
+    foreach (const ControlFlowGraphReachability::Function &function, unreachable)
+        functionItem(unreachableItem, function);
+    unreachableItem->setExpanded(true);
+
+    QTreeWidgetItem *entryPointsItem = new QTreeWidgetItem(m_functionsTreeWidget, QStringList() << i18n("Entry Points (%1)", entryPoints.size()));
+    foreach (const ControlFlowGraphReachability::Function &function, entryPoints)
+        functionItem(entryPointsItem, function);
+
+    QTreeWidgetItem *reachableItem = new QTreeWidgetItem(m_functionsTreeWidget, QStringList() << i18n("Reachable (%1)", reachable.size()));
+    foreach (const ControlFlowGraphReachability::Function &function, reachable)
+    {
+        QStringList reachedFrom = reachability.reachedFrom(function);
+        functionItem(reachableItem, function, reachedFrom.size() > 3 ?
+                                              i18np("%2 and %1 more", "%2 and %1 more", reachedFrom.size() - 3, QStringList(reachedFrom.mid(0, 3)).join(", ")) :
+                                              reachedFrom.join(", "));
+    }
+
+    connect(m_functionsTreeWidget, SIGNAL(itemActivated(QTreeWidgetItem*,int)), SLOT(openFunction(QTreeWidgetItem*)));
+
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close, this);
+    connect(buttonBox, SIGNAL(rejected()), SLOT(reject()));
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addWidget(summaryLabel);
+    layout->addWidget(m_functionsTreeWidget);
+    layout->addWidget(buttonBox);
+    resize(800, 600);
+}
+
+ControlFlowGraphReachabilityDialog::~ControlFlowGraphReachabilityDialog()
+{
+}
+
+void ControlFlowGraphReachabilityDialog::openFunction(QTreeWidgetItem *item)
+{
+    QUrl url = item->data(0, UrlRole).toUrl();
+    if (url.isValid())
+        ICore::self()->documentController()->openDocument(url, KTextEditor::Cursor(item->data(0, LineRole).toInt(), 0));
+}
@@ -41,11 +41,14 @@ void ControlFlowGraphUsesCollector::processUses(ReferencedTopDUContext topContex
     {
         DUChainReadLocker lock(DUChain::lock());
         CodeRepresentation::Ptr code = createCodeRepresentation(topContext.data()->url());
-        processContext(topContext.data(), code);
+        CallSites callSites;
+        processContext(topContext.data(), code, callSites);
+        if (!callSites.isEmpty())
+            emit processFunctionCalls(topContext.data()->url(), callSites);
     }
 }
 
-void ControlFlowGraphUsesCollector::processContext(DUContext *context, CodeRepresentation::Ptr code)
+void ControlFlowGraphUsesCollector::processContext(DUContext *context, CodeRepresentation::Ptr code, CallSites &callSites)
 {
     foreach (const IndexedDeclaration &ideclaration, declarations())
     {
@@ -76,10 +79,14 @@ void ControlFlowGraphUsesCollector::processContext(DUContext *context, CodeRepre
 
                 if (!definition) continue;
 
-                emit processFunctionCall(definition, m_declaration.data(), context->uses()[useIndex]);
+                CallSite callSite;
+                callSite.source = IndexedDeclaration(definition);
+                callSite.target = m_declaration;
+                callSite.range = context->uses()[useIndex].m_range;
+                callSites << callSite;
             }
         }
     }
     foreach (DUContext *child, context->childContexts())
-        processContext(child, code);
+        processContext(child, code, callSites);
 }
@@ -20,6 +20,9 @@
 #ifndef CONTROLFLOWGRAPHUSESCOLLECTOR_H
 #define CONTROLFLOWGRAPHUSESCOLLECTOR_H
 
+#include <QList>
+#include <QMetaType>
+
 #include <language/duchain/navigation/usescollector.h>
 
 #include <language/codegen/coderepresentation.h>
@@ -32,13 +35,24 @@ class ControlFlowGraphUsesCollector : public UsesCollector
 public:
     ControlFlowGraphUsesCollector(IndexedDeclaration declaration);
     virtual ~ControlFlowGraphUsesCollector();
+
+    struct CallSite
+    {
+        IndexedDeclaration source;
+        IndexedDeclaration target;
+        RangeInRevision range;
+    };
+    typedef QList<CallSite> CallSites;
 Q_SIGNALS:
-    void processFunctionCall(Declaration *source, Declaration *target, const Use &use);
+    // All calls found in a file are delivered at once
+    void processFunctionCalls(const KDevelop::IndexedString &url, const ControlFlowGraphUsesCollector::CallSites &callSites);
 private:
     virtual void processUses(ReferencedTopDUContext topContext);
-    void processContext(DUContext *context, CodeRepresentation::Ptr code);
+    void processContext(DUContext *context, CodeRepresentation::Ptr code, CallSites &callSites);
 protected:
     IndexedDeclaration m_declaration;
 };
 
+Q_DECLARE_METATYPE(ControlFlowGraphUsesCollector::CallSites)
+
 #endif
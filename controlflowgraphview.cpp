@@ -23,6 +23,8 @@
 #include <QGraphicsScene>
 #include <QFontMetricsF>
 #include <QMessageBox>
+#include <QListWidget>
+#include <QDebug>
 
 #include <KMessageBox>
 #include <KParts/Part>
@@ -46,30 +48,13 @@ ControlFlowGraphView::ControlFlowGraphView(KDevControlFlowGraphViewPlugin *plugi
 QWidget(parent),
 m_plugin(plugin),
 m_part(0),
-m_dotControlFlowGraph(new DotControlFlowGraph),
-m_duchainControlFlow(new DUChainControlFlow(m_dotControlFlowGraph)),
-m_graphLocked(false)
+m_dotControlFlowGraph(0),
+m_duchainControlFlow(0),
+m_cyclesListWidget(0),
+m_graphLocked(false),
+m_initialized(false)
 {
     setupUi(this);
-    KPluginFactory *factory = KPluginLoader("kgraphviewerpart").factory();
-    if (!factory) {
-        QMessageBox::critical((QWidget *) m_plugin->core()->uiController()->activeMainWindow(), 
-                              i18n("Could not load the KGraphViewer KPart"),
-                              i18n("Unable to load KGraphViewer, please verify that a compatible version is installed."));
-        return;
-    }
-    
-    m_part = factory->create<KParts::ReadOnlyPart>("kgraphviewerpart", this);
-    if (!m_part) {
-        QMessageBox::critical((QWidget *) m_plugin->core()->uiController()->activeMainWindow(), 
-                              i18n("Could not load the KGraphViewer KPart"),
-                              i18n("Unable to create a KGraphViewer instance, please verify that a compatible version is installed."));
-        return;
-    }
-    
-    QMetaObject::invokeMethod(m_part, "setReadWrite");
-
-    verticalLayout->addWidget(m_part->widget());
 
     modeFunctionToolButton->setIcon(QIcon::fromTheme("code-function"));
     modeClassToolButton->setIcon(QIcon::fromTheme("code-class"));
@@ -79,9 +64,12 @@ m_graphLocked(false)
     clusteringProjectToolButton->setIcon(QIcon::fromTheme("folder-development"));
     useFolderNameToolButton->setIcon(QIcon::fromTheme("folder-favorites"));
     drawIncomingArcsToolButton->setIcon(QIcon::fromTheme("draw-arrow-down"));
+    expandOverridesToolButton->setIcon(QIcon::fromTheme("code-class"));
+    collapseCyclesToolButton->setIcon(QIcon::fromTheme("view-refresh"));
+    excludeLibrariesToolButton->setIcon(QIcon::fromTheme("view-filter"));
+    layoutWorkerToolButton->setIcon(QIcon::fromTheme("system-run"));
     maxLevelToolButton->setIcon(QIcon::fromTheme("zoom-fit-height"));
     exportToolButton->setIcon(QIcon::fromTheme("document-export"));
-    m_duchainControlFlow->setMaxLevel(2);
 
     birdseyeToolButton->setIcon(QIcon::fromTheme("edit-find"));
     usesHoverToolButton->setIcon(QIcon::fromTheme("input-mouse"));
@@ -108,9 +96,75 @@ m_graphLocked(false)
     connect(maxLevelSpinBox, SIGNAL(valueChanged(int)), SLOT(setMaxLevel(int)));
     connect(maxLevelToolButton, SIGNAL(toggled(bool)), SLOT(setUseMaxLevel(bool)));
     connect(drawIncomingArcsToolButton, SIGNAL(toggled(bool)), SLOT(setDrawIncomingArcs(bool)));
+    connect(expandOverridesToolButton, SIGNAL(toggled(bool)), SLOT(setExpandOverrides(bool)));
+    connect(collapseCyclesToolButton, SIGNAL(toggled(bool)), SLOT(setCollapseCycles(bool)));
+    connect(excludeLibrariesToolButton, SIGNAL(toggled(bool)), SLOT(setExcludeLibraries(bool)));
+    connect(layoutWorkerToolButton, SIGNAL(toggled(bool)), SLOT(setLayoutWorker(bool)));
     connect(useFolderNameToolButton, SIGNAL(toggled(bool)), SLOT(setUseFolderName(bool)));
     connect(useShortNamesToolButton, SIGNAL(toggled(bool)), SLOT(setUseShortNames(bool)));
     connect(lockControlFlowGraphToolButton, SIGNAL(toggled(bool)), SLOT(updateLockIcon(bool)));
+    connect(exportToolButton, SIGNAL(clicked()), SLOT(exportControlFlowGraph()));
+
+    m_plugin->registerToolView(this);
+}
+
+void ControlFlowGraphView::initialize()
+{
+    // The part and the graph engine are only created when the view is first shown
+    if (m_initialized)
+        return;
+    m_initialized = true;
+
+    m_dotControlFlowGraph = new DotControlFlowGraph;
+    m_duchainControlFlow = new DUChainControlFlow(m_dotControlFlowGraph);
+    m_duchainControlFlow->setLocked(m_graphLocked);
+    m_duchainControlFlow->setCache(m_plugin->cache());
+    m_duchainControlFlow->setClassHierarchy(m_plugin->classHierarchy());
+    m_duchainControlFlow->setExpandOverrides(expandOverridesToolButton->isChecked());
+    m_duchainControlFlow->setCallFilter(callFilter(excludeLibrariesToolButton->isChecked()));
+    m_duchainControlFlow->setMaxLevel(maxLevelToolButton->isChecked() ? maxLevelSpinBox->value() : 0);
+    // Keep interactive graphs small enough to be laid out quickly, wherever the cursor is
+    m_duchainControlFlow->setMaxNodes(100);
+    m_duchainControlFlow->setMaxEdges(300);
+    // Depth 1 shows up right away, deeper levels follow for up to two seconds
+    m_duchainControlFlow->setLevelBudget(2000);
+    // Graphs laid out by the killable dot worker only have to be drawn by the part
+    layoutWorkerToolButton->setEnabled(DotControlFlowGraph::externalLayoutAvailable());
+    m_dotControlFlowGraph->setExternalLayout(layoutWorkerToolButton->isEnabled() && layoutWorkerToolButton->isChecked(), 10000);
+
+    if (!DotControlFlowGraph::graphvizAvailable()) {
+        QMessageBox::critical((QWidget *) m_plugin->core()->uiController()->activeMainWindow(),
+                              i18n("Could not load Graphviz"),
+                              i18n("Unable to load the Graphviz libraries, please verify that Graphviz is installed."));
+        return;
+    }
+
+    KPluginFactory *factory = KPluginLoader("kgraphviewerpart").factory();
+    if (!factory) {
+        QMessageBox::critical((QWidget *) m_plugin->core()->uiController()->activeMainWindow(), 
+                              i18n("Could not load the KGraphViewer KPart"),
+                              i18n("Unable to load KGraphViewer, please verify that a compatible version is installed."));
+        return;
+    }
+    
+    m_part = factory->create<KParts::ReadOnlyPart>("kgraphviewerpart", this);
+    if (!m_part) {
+        QMessageBox::critical((QWidget *) m_plugin->core()->uiController()->activeMainWindow(), 
+                              i18n("Could not create the KGraphViewer KPart"),
+                              i18n("Unable to create a KGraphViewer instance, please verify that a compatible version is installed."));
+        return;
+    }
+    
+    QMetaObject::invokeMethod(m_part, "setReadWrite");
+    updatePartLayout();
+
+    verticalLayout->addWidget(m_part->widget());
+
+    // Recursion cycles of the current graph, only shown when there are some
+    m_cyclesListWidget = new QListWidget(this);
+    m_cyclesListWidget->setMaximumHeight(fontMetrics().height() * 6);
+    m_cyclesListWidget->hide();
+    verticalLayout->addWidget(m_cyclesListWidget);
 
     // Left buttons signals
     connect(zoomoutToolButton, SIGNAL(clicked()), m_part->actionCollection()->action("view_zoom_out"), SIGNAL(triggered()));
@@ -121,7 +175,6 @@ m_graphLocked(false)
     connect(m_part, SIGNAL(selectionIs(const QList<QString>, const QPoint&)),
             m_duchainControlFlow, SLOT(slotGraphElementSelected(QList<QString>,QPoint)));
     connect(m_part, SIGNAL(hoverEnter(QString)), m_duchainControlFlow, SLOT(slotEdgeHover(QString)));
-    connect(exportToolButton, SIGNAL(clicked()), SLOT(exportControlFlowGraph()));
     connect(usesHoverToolButton, SIGNAL(toggled(bool)), m_duchainControlFlow, SLOT(setShowUsesOnEdgeHover(bool)));
 
     // Make sure we have a graph before we hook up signals to act on it
@@ -129,11 +182,9 @@ m_graphLocked(false)
 
     // Graph generation signals
     connect(m_dotControlFlowGraph, SIGNAL(loadLibrary(graph_t*)), m_part, SLOT(slotLoadLibrary(graph_t*)));
+    connect(m_dotControlFlowGraph, SIGNAL(cyclesFound(QStringList)), SLOT(setCycles(QStringList)));
     connect(m_duchainControlFlow, SIGNAL(startingJob()), SLOT(startingJob()));
     connect(m_duchainControlFlow, SIGNAL(jobDone()), SLOT(graphDone()));
-
-    m_plugin->registerToolView(this);
-            
 }
 
 ControlFlowGraphView::~ControlFlowGraphView()
@@ -146,12 +197,24 @@ ControlFlowGraphView::~ControlFlowGraphView()
 
 void ControlFlowGraphView::refreshGraph()
 {
-    m_duchainControlFlow->refreshGraph();
+    if (m_part)
+        m_duchainControlFlow->refreshGraph();
 }
 
 void ControlFlowGraphView::newGraph()
 {
-    m_duchainControlFlow->newGraph();
+    if (m_part)
+        m_duchainControlFlow->newGraph();
+}
+
+void ControlFlowGraphView::findCallPaths(const IndexedDeclaration &target)
+{
+    if (!m_part)
+        return;
+
+    // Keep the answer on screen instead of following the cursor
+    lockControlFlowGraphToolButton->setChecked(true);
+    m_duchainControlFlow->findCallPaths(target);
 }
 
 void ControlFlowGraphView::setProjectButtonsEnabled(bool enabled)
@@ -162,17 +225,21 @@ void ControlFlowGraphView::setProjectButtonsEnabled(bool enabled)
 
 void ControlFlowGraphView::cursorPositionChanged(KTextEditor::View *view, const KTextEditor::Cursor &cursor)
 {
-    m_duchainControlFlow->cursorPositionChanged(view, cursor);
+    if (m_part)
+        m_duchainControlFlow->cursorPositionChanged(view, cursor);
 }
 
 void ControlFlowGraphView::startingJob()
 {
-    setEnabled(false);
+    // The view follows the cursor while the job deepens, only the actions working on the finished graph wait
+    collapseCyclesToolButton->setEnabled(false);
+    exportToolButton->setEnabled(false);
 }
 
 void ControlFlowGraphView::graphDone()
 {
-    setEnabled(true);
+    collapseCyclesToolButton->setEnabled(true);
+    exportToolButton->setEnabled(true);
 }
 
 void ControlFlowGraphView::exportControlFlowGraph()
@@ -180,7 +247,7 @@ void ControlFlowGraphView::exportControlFlowGraph()
     QPointer<ControlFlowGraphFileDialog> fileDialog;
     if ((fileDialog = m_plugin->exportControlFlowGraph(ControlFlowGraphFileDialog::NoConfigurationButtons)) && !fileDialog->selectedFiles().isEmpty())
     {
-        m_dotControlFlowGraph->exportGraph(fileDialog->selectedFiles()[0]);
+        m_dotControlFlowGraph->exportGraph(fileDialog->exportFileNames());
         KMessageBox::information(this, i18n("Control flow graph exported"), i18n("Export Control Flow Graph"));
     }
 }
@@ -189,8 +256,10 @@ void ControlFlowGraphView::updateLockIcon(bool checked)
 {
     lockControlFlowGraphToolButton->setIcon(QIcon::fromTheme(checked ? "document-encrypt":"document-decrypt"));
     lockControlFlowGraphToolButton->setToolTip(checked ? i18n("Unlock control flow graph"):i18n("Lock control flow graph"));
-    m_duchainControlFlow->setLocked(checked);
     m_graphLocked = checked;
+    if (!m_part)
+        return;
+    m_duchainControlFlow->setLocked(checked);
     if (!checked)
         m_duchainControlFlow->refreshGraph();
 }
@@ -200,7 +269,7 @@ void ControlFlowGraphView::setControlFlowClass(bool checked)
     if (checked)
     {
         m_duchainControlFlow->setControlFlowMode(DUChainControlFlow::ControlFlowClass);
-        m_duchainControlFlow->refreshGraph();
+        m_duchainControlFlow->redrawGraph();
         clusteringClassToolButton->setChecked(false);
         clusteringClassToolButton->setEnabled(false);
         clusteringNamespaceToolButton->setEnabled(true);
@@ -212,7 +281,7 @@ void ControlFlowGraphView::setControlFlowFunction(bool checked)
     if (checked)
     {
         m_duchainControlFlow->setControlFlowMode(DUChainControlFlow::ControlFlowFunction);
-        m_duchainControlFlow->refreshGraph();
+        m_duchainControlFlow->redrawGraph();
         clusteringClassToolButton->setEnabled(true);
         clusteringNamespaceToolButton->setEnabled(true);
     }
@@ -223,7 +292,7 @@ void ControlFlowGraphView::setControlFlowNamespace(bool checked)
     if (checked)
     {
         m_duchainControlFlow->setControlFlowMode(DUChainControlFlow::ControlFlowNamespace);
-        m_duchainControlFlow->refreshGraph();
+        m_duchainControlFlow->redrawGraph();
         clusteringClassToolButton->setChecked(false);
         clusteringClassToolButton->setEnabled(false);
         clusteringNamespaceToolButton->setChecked(false);
@@ -235,7 +304,7 @@ void ControlFlowGraphView::setClusteringClass(bool checked)
 {
     Q_UNUSED(checked);
     m_duchainControlFlow->setClusteringModes(m_duchainControlFlow->clusteringModes() ^ DUChainControlFlow::ClusteringClass);
-    m_duchainControlFlow->refreshGraph();
+    m_duchainControlFlow->redrawGraph();
     useShortNamesToolButton->setEnabled(m_duchainControlFlow->clusteringModes() ? true:false);
 }
 
@@ -243,7 +312,7 @@ void ControlFlowGraphView::setClusteringProject(bool checked)
 {
     Q_UNUSED(checked);
     m_duchainControlFlow->setClusteringModes(m_duchainControlFlow->clusteringModes() ^ DUChainControlFlow::ClusteringProject);
-    m_duchainControlFlow->refreshGraph();
+    m_duchainControlFlow->redrawGraph();
     useShortNamesToolButton->setEnabled(m_duchainControlFlow->clusteringModes() ? true:false);
 }
 
@@ -251,7 +320,7 @@ void ControlFlowGraphView::setClusteringNamespace(bool checked)
 {
     Q_UNUSED(checked);
     m_duchainControlFlow->setClusteringModes(m_duchainControlFlow->clusteringModes() ^ DUChainControlFlow::ClusteringNamespace);
-    m_duchainControlFlow->refreshGraph();
+    m_duchainControlFlow->redrawGraph();
     useShortNamesToolButton->setEnabled(m_duchainControlFlow->clusteringModes() ? true:false);
 }
 
@@ -273,21 +342,84 @@ void ControlFlowGraphView::setDrawIncomingArcs(bool checked)
     m_duchainControlFlow->refreshGraph();
 }
 
+void ControlFlowGraphView::setExpandOverrides(bool checked)
+{
+    m_duchainControlFlow->setExpandOverrides(checked);
+    m_duchainControlFlow->refreshGraph();
+}
+
+void ControlFlowGraphView::setExcludeLibraries(bool checked)
+{
+    m_duchainControlFlow->setCallFilter(callFilter(checked));
+    m_duchainControlFlow->refreshGraph();
+}
+
+ControlFlowGraphCallFilter ControlFlowGraphView::callFilter(bool excludeLibraries) const
+{
+    ControlFlowGraphCallFilter callFilter;
+    if (excludeLibraries)
+    {
+        callFilter.setExcludedNamespaces(ControlFlowGraphCallFilter::defaultExcludedNamespaces());
+        callFilter.setExcludedPaths(ControlFlowGraphCallFilter::defaultExcludedPaths());
+    }
+    return callFilter;
+}
+
+void ControlFlowGraphView::setLayoutWorker(bool checked)
+{
+    m_dotControlFlowGraph->setExternalLayout(checked, 10000);
+    updatePartLayout();
+    m_duchainControlFlow->redrawGraph();
+}
+
+void ControlFlowGraphView::updatePartLayout()
+{
+    if (!m_part)
+        return;
+
+    // Graphs from the worker are laid out already, so the part must not lay them out again
+    bool externalLayout = m_dotControlFlowGraph->externalLayout();
+    if (!QMetaObject::invokeMethod(m_part, "setLayoutCommand", Q_ARG(QString, externalLayout ? "nop2" : "dot")) && externalLayout)
+    {
+        qWarning() << "The KGraphViewer part cannot be told to skip the layout, graphs are laid out in process";
+        m_dotControlFlowGraph->setExternalLayout(false);
+        layoutWorkerToolButton->blockSignals(true);
+        layoutWorkerToolButton->setChecked(false);
+        layoutWorkerToolButton->blockSignals(false);
+        layoutWorkerToolButton->setEnabled(false);
+    }
+}
+
+void ControlFlowGraphView::setCollapseCycles(bool checked)
+{
+    // The cycles are already known, only the retained graph is drawn again
+    m_dotControlFlowGraph->setCyclesCollapsed(checked);
+}
+
+void ControlFlowGraphView::setCycles(const QStringList &cycles)
+{
+    m_cyclesListWidget->clear();
+    foreach (const QString &cycle, cycles)
+        m_cyclesListWidget->addItem(i18n("Recursion: %1", cycle));
+    m_cyclesListWidget->setVisible(!cycles.isEmpty());
+}
+
 void ControlFlowGraphView::setUseFolderName(bool checked)
 {
     m_duchainControlFlow->setUseFolderName(checked);
-    m_duchainControlFlow->refreshGraph();
+    m_duchainControlFlow->redrawGraph();
 }
 
 void ControlFlowGraphView::setUseShortNames(bool checked)
 {
     m_duchainControlFlow->setUseShortNames(checked);
-    m_duchainControlFlow->refreshGraph();
+    m_duchainControlFlow->redrawGraph();
 }
 
 void ControlFlowGraphView::showEvent(QShowEvent *event)
 {
     Q_UNUSED(event);
+    initialize();
     m_plugin->setActiveToolView(this);
 }
 
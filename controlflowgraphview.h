@@ -24,6 +24,10 @@
 
 #include <QPointer>
 
+#include <language/duchain/indexeddeclaration.h>
+
+#include "controlflowgraphcallfilter.h"
+
 namespace KParts
 {
     class ReadOnlyPart;
@@ -35,6 +39,7 @@ namespace KTextEditor
 }
 
 class QGraphicsView;
+class QListWidget;
 class KDevControlFlowGraphViewPlugin;
 class DUChainControlFlow;
 class DotControlFlowGraph;
@@ -48,6 +53,7 @@ public:
 
     void refreshGraph();
     void newGraph();
+    void findCallPaths(const KDevelop::IndexedDeclaration &target);
 public Q_SLOTS:
     void setProjectButtonsEnabled(bool enabled);
     void cursorPositionChanged(KTextEditor::View *view, const KTextEditor::Cursor &cursor);
@@ -64,6 +70,11 @@ public Q_SLOTS:
     void setUseMaxLevel(bool checked);
     void setMaxLevel(int value);
     void setDrawIncomingArcs(bool checked);
+    void setExpandOverrides(bool checked);
+    void setCollapseCycles(bool checked);
+    void setExcludeLibraries(bool checked);
+    void setLayoutWorker(bool checked);
+    void setCycles(const QStringList &cycles);
     void setUseFolderName(bool checked);
     void setUseShortNames(bool checked);
 
@@ -75,11 +86,17 @@ protected:
     void showEvent(QShowEvent *event);
     void hideEvent(QHideEvent *event);
 private:
+    void initialize();
+    ControlFlowGraphCallFilter callFilter(bool excludeLibraries) const;
+    void updatePartLayout();
+
     KDevControlFlowGraphViewPlugin *m_plugin;
     QPointer<KParts::ReadOnlyPart>  m_part;
     QPointer<DotControlFlowGraph>   m_dotControlFlowGraph;
     QPointer<DUChainControlFlow>    m_duchainControlFlow;
+    QListWidget                     *m_cyclesListWidget;
     bool                            m_graphLocked;
+    bool                            m_initialized;
 };
 
 #endif
@@ -19,10 +19,21 @@
 
 #include "dotcontrolflowgraph.h"
 
+#include <cmath>
 #include <cstdio>
+#include <cstring>
+
+#include <QDebug>
+#include <QProcess>
+#include <QElapsedTimer>
+#include <QStandardPaths>
+
+#include <KLocalizedString>
 
 #include <language/duchain/declaration.h>
 
+#include "dotcontrolflowgraphlibrary.h"
+
 namespace {
     // C interface takes char*, so to avoid deprecated cast and/or undefined behaviour,
     // defined the needed constants here.
@@ -35,154 +46,712 @@ namespace {
     static char SHAPE[] = "shape";
     static char STYLE[] = "style";
     static char BOX[] = "box";
+    static char NOTE[] = "note";
+    static char DASHED[] = "dashed";
+    static char BOX3D[] = "box3d";
+    static char ID[] = "id";
+    static char CLUSTER_PREFIX[] = "cluster_";
+    static char COLLAPSED_PREFIX[] = "collapsed_";
+    static char MULTIPLICITY[] = "multiplicity";
+    static char PENWIDTH[] = "penwidth";
+    static char TOOLTIP[] = "tooltip";
+    static char COLOR[] = "color";
+    static char CYCLE_COLOR[] = "#d00000";
+    static char CYCLE_PENWIDTH[] = "2.5";
+    static char CYCLE_PREFIX[] = "cycle_";
+
+    // Graphs are written to and read back from the layout worker through memory buffers
+    struct DotBuffer
+    {
+        DotBuffer(const QByteArray &data = QByteArray()) : data(data), position(0) {}
+        QByteArray data;
+        int position;
+    };
+
+    int bufferRead(void *chan, char *buf, int bufsize)
+    {
+        DotBuffer *buffer = static_cast<DotBuffer *>(chan);
+        int size = qMin(bufsize, buffer->data.size() - buffer->position);
+        std::memcpy(buf, buffer->data.constData() + buffer->position, size);
+        buffer->position += size;
+        return size;
+    }
+
+    int bufferPutString(void *chan, const char *str)
+    {
+        static_cast<DotBuffer *>(chan)->data.append(str);
+        return 0;
+    }
+
+    int bufferFlush(void */*chan*/)
+    {
+        return 0;
+    }
+
+    Agiodisc_t bufferIoDiscipline = { bufferRead, bufferPutString, bufferFlush };
+
+    // Graphs are only built once DotControlFlowGraph::graphvizAvailable() succeeded
+    const DotControlFlowGraphLibrary &graphviz()
+    {
+        return *DotControlFlowGraphLibrary::self();
+    }
+
+    Agdisc_t *graphDiscipline()
+    {
+#ifdef HAVE_GRAPHVIZ_MEMDISC
+        static Agdisc_t discipline = { graphviz().AgMemDisc, graphviz().AgIdDisc, &bufferIoDiscipline };
+#else
+        static Agdisc_t discipline = { graphviz().AgIdDisc, &bufferIoDiscipline };
+#endif
+        return &discipline;
+    }
 }
 
 QMutex DotControlFlowGraph::mutex;
+GVC_t *DotControlFlowGraph::s_gvc = 0;
 
-DotControlFlowGraph::DotControlFlowGraph() : m_rootGraph(0)
+DotControlFlowGraph::DotControlFlowGraph()
+: m_rootGraph(0), m_pendingGraph(0), m_displayedGraph(0),
+  m_cyclesFound(false), m_collapseCycles(false), m_externalLayout(false), m_layoutTimeout(30000)
 {
-    m_gvc = gvContext();
 }
 
 DotControlFlowGraph::~DotControlFlowGraph()
 {
-    gvFreeContext(m_gvc);
+    // Layouts are freed right after use, so the graphs can be closed directly
+    if (m_rootGraph)
+        graphviz().agclose(m_rootGraph);
+    if (m_pendingGraph)
+        graphviz().agclose(m_pendingGraph);
+    if (m_displayedGraph)
+        graphviz().agclose(m_displayedGraph);
+    foreach (Agraph_t *graph, m_retiredGraphs)
+        graphviz().agclose(graph);
+}
+
+GVC_t *DotControlFlowGraph::context()
+{
+    // Graphviz loads its plugin configuration once per context, so all graphs share a single one.
+    // Callers must hold the mutex, which also serializes the non reentrant layout and render code.
+    if (!s_gvc)
+        s_gvc = graphviz().gvContext();
+    return s_gvc;
+}
+
+void DotControlFlowGraph::releaseContext()
+{
+    QMutexLocker locker(&mutex);
+    if (s_gvc)
+    {
+        graphviz().gvFreeContext(s_gvc);
+        s_gvc = 0;
+    }
+}
+
+bool DotControlFlowGraph::graphvizAvailable()
+{
+    return DotControlFlowGraphLibrary::self();
+}
+
+bool DotControlFlowGraph::externalLayoutAvailable()
+{
+    return !QStandardPaths::findExecutable("dot").isEmpty();
+}
+
+void DotControlFlowGraph::setExternalLayout(bool externalLayout, int timeout)
+{
+    m_externalLayout = externalLayout;
+    m_layoutTimeout = timeout;
+}
+
+bool DotControlFlowGraph::externalLayout() const
+{
+    return m_externalLayout;
+}
+
+void DotControlFlowGraph::abortLayout()
+{
+    m_layoutAborted = 1;
+}
+
+bool DotControlFlowGraph::runLayoutWorker(const QStringList &arguments, const QByteArray &input, QByteArray *output)
+{
+    QProcess worker;
+    worker.start("dot", arguments);
+    if (!worker.waitForStarted())
+    {
+        qWarning() << "Could not start the Graphviz layout worker";
+        return false;
+    }
+    worker.write(input);
+    worker.closeWriteChannel();
+
+    // Poll the worker so that an abort request or an exhausted budget kills it right away
+    QElapsedTimer timer;
+    timer.start();
+    while (!worker.waitForFinished(50) && worker.state() != QProcess::NotRunning)
+    {
+        if (m_layoutAborted.load() || (m_layoutTimeout > 0 && timer.hasExpired(m_layoutTimeout)))
+        {
+            qWarning() << "Killing the Graphviz layout worker after" << timer.elapsed() << "ms";
+            worker.kill();
+            worker.waitForFinished();
+            return false;
+        }
+    }
+
+    if (worker.exitStatus() != QProcess::NormalExit || worker.exitCode() != 0)
+    {
+        qWarning() << "Graphviz layout worker failed:" << worker.readAllStandardError();
+        return false;
+    }
+    if (output)
+        *output = worker.readAllStandardOutput();
+    return true;
 }
 
 void DotControlFlowGraph::graphDone()
 {
+    closeRetiredGraphs();
+
     if (m_rootGraph)
     {
-        if (mutex.tryLock())
+        // Cycles only change with the elements, not when clusters or cycles are collapsed
+        if (!m_cyclesFound)
+        {
+            m_cyclesFound = true;
+            findCycles();
+            if (m_collapseCycles && !m_cycles.isEmpty())
+                redrawElements();
+        }
+        highlightCycles();
+    }
+
+    // An empty graph only clears the part, it is handed over without any layout
+    if (m_rootGraph && m_externalLayout && !m_elements.isEmpty())
+    {
+        // The laid out graph replaces the built one, so the part only has to draw it
+        DotBuffer input, output;
+        mutex.lock();
+        graphviz().agwrite(m_rootGraph, &input);
+        mutex.unlock();
+
+        Agraph_t *graph = 0;
+        if (runLayoutWorker(QStringList() << "-Txdot", input.data, &output.data))
+        {
+            QMutexLocker locker(&mutex);
+            graph = graphviz().agread(&output, graphDiscipline());
+        }
+
+        QMutexLocker locker(&m_bufferMutex);
+        graphviz().agclose(m_rootGraph);
+        m_rootGraph = 0;
+        if (!graph)
+            return;
+        if (m_pendingGraph)
+            graphviz().agclose(m_pendingGraph);
+        m_pendingGraph = graph;
+        locker.unlock();
+
+        QMetaObject::invokeMethod(this, "swapBuffers", Qt::QueuedConnection);
+    }
+    else if (m_rootGraph)
+    {
+        if (!m_elements.isEmpty())
         {
-            gvLayout(m_gvc, m_rootGraph, SUFFIX);
-            gvFreeLayout(m_gvc, m_rootGraph);
+            mutex.lock();
+            graphviz().gvLayout(context(), m_rootGraph, SUFFIX);
+            graphviz().gvFreeLayout(context(), m_rootGraph);
             mutex.unlock();
-            emit loadLibrary(m_rootGraph);
         }
+
+        // Hand the finished graph over, the next one is built into a fresh buffer
+        m_bufferMutex.lock();
+        if (m_pendingGraph)
+            graphviz().agclose(m_pendingGraph);
+        m_pendingGraph = m_rootGraph;
+        m_rootGraph = 0;
+        m_bufferMutex.unlock();
+
+        QMetaObject::invokeMethod(this, "swapBuffers", Qt::QueuedConnection);
     }
 }
 
-void DotControlFlowGraph::clearGraph()
+void DotControlFlowGraph::swapBuffers()
 {
-    if (m_rootGraph)
+    // Only the pointers are swapped here, the main thread never waits for a layout or an export
+    m_bufferMutex.lock();
+    Agraph_t *previousGraph = m_displayedGraph;
+    if (m_pendingGraph)
     {
-        gvFreeLayout(m_gvc, m_rootGraph);
-        agclose(m_rootGraph);
-        m_rootGraph = 0;
+        m_displayedGraph = m_pendingGraph;
+        m_pendingGraph = 0;
     }
+    m_bufferMutex.unlock();
 
-    m_namedGraphs.clear();
-    m_rootGraph = agopen(GRAPH_NAME, Agdirected, NULL);
+    if (m_displayedGraph == previousGraph)
+        return;
+
+    // The part reads the graph synchronously, the previous snapshot is closed by the next graphDone
+    emit loadLibrary(m_displayedGraph);
+    if (previousGraph)
+    {
+        QMutexLocker locker(&m_bufferMutex);
+        m_retiredGraphs << previousGraph;
+    }
+}
+
+void DotControlFlowGraph::closeRetiredGraphs()
+{
+    m_bufferMutex.lock();
+    QList<Agraph_t *> graphs = m_retiredGraphs;
+    m_retiredGraphs.clear();
+    m_bufferMutex.unlock();
+
+    QMutexLocker locker(&mutex);
+    foreach (Agraph_t *graph, graphs)
+        graphviz().agclose(graph);
+}
+
+void DotControlFlowGraph::clearGraph()
+{
+    prepareNewGraph();
     graphDone();
 }
 
 void DotControlFlowGraph::exportGraph(const QString &fileName)
 {
-    if (m_rootGraph)
+    exportGraph(QStringList() << fileName);
+}
+
+void DotControlFlowGraph::exportGraph(const QStringList &fileNames)
+{
+    if (fileNames.isEmpty())
+        return;
+
+    // Export the graph being built if any, otherwise the latest finished one. Only the snapshot
+    // is taken under the buffer lock, finished graphs keep being swapped in while it is rendered.
+    DotBuffer snapshot;
+    {
+        QMutexLocker locker(&m_bufferMutex);
+        Agraph_t *graph = m_rootGraph ? m_rootGraph : (m_pendingGraph ? m_pendingGraph : m_displayedGraph);
+        if (!graph)
+            return;
+        QMutexLocker contextLocker(&mutex);
+        graphviz().agwrite(graph, &snapshot);
+    }
+
+    if (m_externalLayout)
     {
-        gvLayout(m_gvc, m_rootGraph, SUFFIX);
-        gvRenderFilename(m_gvc, m_rootGraph, fileName.right(fileName.size()-fileName.lastIndexOf('.')-1).toUtf8().data(), fileName.toUtf8().data());
-        gvFreeLayout(m_gvc, m_rootGraph);
+        // The worker lays the graph out once and writes every target itself
+        QStringList arguments;
+        foreach (const QString &fileName, fileNames)
+            arguments << "-T" + fileName.right(fileName.size()-fileName.lastIndexOf('.')-1) << "-o" + fileName;
+        runLayoutWorker(arguments, snapshot.data, 0);
+    }
+    else
+    {
+        QMutexLocker contextLocker(&mutex);
+        Agraph_t *graph = graphviz().agread(&snapshot, graphDiscipline());
+        if (!graph)
+            return;
+
+        // One layout pass serves every target. Renderers share the GVC job state and
+        // Graphviz is not reentrant, so the targets are rendered one after another.
+        graphviz().gvLayout(context(), graph, SUFFIX);
+        foreach (const QString &fileName, fileNames)
+            graphviz().gvRenderFilename(context(), graph, fileName.right(fileName.size()-fileName.lastIndexOf('.')-1).toUtf8().data(), fileName.toUtf8().data());
+        graphviz().gvFreeLayout(context(), graph);
+        graphviz().agclose(graph);
     }
 }
 
 void DotControlFlowGraph::prepareNewGraph()
 {
-    clearGraph();
+    m_elements.clear();
+    m_cycles.clear();
+    m_cycleOfNode.clear();
+    m_cyclesFound = false;
+    resetGraph();
 }
 
-void DotControlFlowGraph::foundRootNode(const QStringList &containers, const QString &label)
+void DotControlFlowGraph::foundRootNode(const QStringList &containers, uint id, const QString &label)
 {
-    Agraph_t *graph = m_rootGraph;
+    // Nothing is drawn when the Graphviz libraries could not be resolved
+    if (!graphvizAvailable())
+        return;
     if (!m_rootGraph) {
         // This shouldn't happen, as the graph should be generated before this function
         // is connected.
         Q_ASSERT(false);
         return;
     }
-    QString absoluteContainer;
-    foreach (const QString& container, containers)
-    {
-        absoluteContainer += container;
-        graph = m_namedGraphs[absoluteContainer] = agsubg(graph, ("cluster_" + absoluteContainer).toUtf8().data(), 1);
-        agsafeset(graph, LABEL, container.toUtf8().data(), EMPTY);
-    }
+    m_elements << GraphElement(GraphElement::RootNode, containers, id, label);
+    drawElement(m_elements.last());
+}
 
-    Agnode_t *node = agnode(graph, (containers.join("") + label).toUtf8().data(), 1);
-    agsafeset(node, SHAPE, BOX, EMPTY);
-    QColor c = colorFromQualifiedIdentifier(label);
-    char color[8];
-    std::sprintf (color, "#%02x%02x%02x", c.red(), c.green(), c.blue());
-    agsafeset(node, STYLE, FILLED, EMPTY);
-    agsafeset(node, FILLCOLOR, color, EMPTY);
-    agsafeset(node, LABEL, label.toUtf8().data(), EMPTY);
+void DotControlFlowGraph::foundFunctionCall(const QStringList &sourceContainers, uint sourceId, const QString &source,
+                                            const QStringList &targetContainers, uint targetId, const QString &target)
+{
+    // Nothing is drawn when the Graphviz libraries could not be resolved
+    if (!graphvizAvailable())
+        return;
+    if (!m_rootGraph) {
+        // This shouldn't happen, as the graph should be generated before this function
+        // is connected.
+        Q_ASSERT(false);
+        return;
+    }
+    m_elements << GraphElement(GraphElement::FunctionCall, sourceContainers, sourceId, source, targetContainers, targetId, target);
+    drawElement(m_elements.last());
 }
 
-void DotControlFlowGraph::foundFunctionCall(const QStringList &sourceContainers, const QString &source, const QStringList &targetContainers, const QString &target)
+void DotControlFlowGraph::foundSummaryNode(const QStringList &containers, uint id, const QString &source, int hiddenCallees)
 {
+    // Nothing is drawn when the Graphviz libraries could not be resolved
+    if (!graphvizAvailable())
+        return;
     if (!m_rootGraph) {
         // This shouldn't happen, as the graph should be generated before this function
         // is connected.
         Q_ASSERT(false);
         return;
     }
-    Agraph_t *sourceGraph, *targetGraph, *newGraph;
-    sourceGraph = targetGraph = m_rootGraph;
-    QString absoluteContainer;
+    m_elements << GraphElement(GraphElement::SummaryNode, containers, id, source);
+    m_elements.last().hiddenCallees = hiddenCallees;
+    drawElement(m_elements.last());
+}
+
+QStringList DotControlFlowGraph::edgeMembers(const QString &edgeId)
+{
+    QMutexLocker locker(&m_bufferMutex);
+    return m_aggregateEdges.value(edgeId, QStringList() << edgeId);
+}
 
-    foreach (const QString& container, sourceContainers)
+bool DotControlFlowGraph::toggleCluster(const QString &elementName)
+{
+    QString cluster;
+    if (elementName.startsWith(CLUSTER_PREFIX) && m_namedGraphs.contains(elementName.mid(qstrlen(CLUSTER_PREFIX))))
+        cluster = elementName.mid(qstrlen(CLUSTER_PREFIX));
+    else if (m_collapsedNodes.contains(elementName))
+        cluster = m_collapsedNodes.value(elementName);
+    else
+        return false;
+
+    setClusterCollapsed(cluster, !m_collapsedClusters.contains(cluster));
+    return true;
+}
+
+void DotControlFlowGraph::setClusterCollapsed(const QString &cluster, bool collapsed)
+{
+    if (collapsed)
+        m_collapsedClusters.insert(cluster);
+    else
+        m_collapsedClusters.remove(cluster);
+
+    // Lay out the retained graph again instead of asking for a new traversal
+    redrawElements();
+    graphDone();
+}
+
+void DotControlFlowGraph::setCyclesCollapsed(bool collapsed)
+{
+    m_collapseCycles = collapsed;
+    redrawElements();
+    graphDone();
+}
+
+void DotControlFlowGraph::redrawElements()
+{
+    resetGraph();
+    foreach (const GraphElement &element, m_elements)
+        drawElement(element);
+}
+
+void DotControlFlowGraph::findCycles()
+{
+    m_cycles.clear();
+    m_cycleOfNode.clear();
+    m_nodeLabels.clear();
+
+    QHash<uint, QList<uint> > callees;
+    QSet<uint> selfCalls;
+    foreach (const GraphElement &element, m_elements)
     {
-        Agraph_t *previousGraph = sourceGraph;
-        absoluteContainer += container;
-        if (!m_namedGraphs.contains(absoluteContainer))
+        if (element.type != GraphElement::FunctionCall)
+            continue;
+        callees[element.sourceId] << element.targetId;
+        callees[element.targetId];
+        m_nodeLabels.insert(element.sourceId, element.source);
+        m_nodeLabels.insert(element.targetId, element.target);
+        if (element.sourceId == element.targetId)
+            selfCalls.insert(element.sourceId);
+    }
+
+    // Tarjan's algorithm with an explicit stack, call chains may be deeper than the thread stack allows
+    struct Frame
+    {
+        uint node;
+        int nextCallee;
+    };
+    QHash<uint, int> indexes, lowLinks;
+    QList<uint> componentStack;
+    QSet<uint> onComponentStack;
+    QVector<Frame> frames;
+    int nextIndex = 0;
+    foreach (uint root, callees.keys())
+    {
+        if (indexes.contains(root))
+            continue;
+
+        Frame rootFrame = { root, 0 };
+        frames.append(rootFrame);
+        indexes[root] = lowLinks[root] = nextIndex++;
+        componentStack << root;
+        onComponentStack << root;
+        while (!frames.isEmpty())
         {
-            newGraph = agsubg(previousGraph, ("cluster_" + absoluteContainer).toUtf8().data(), 1);
-            m_namedGraphs.insert(absoluteContainer, newGraph);
-            agsafeset(newGraph, LABEL, container.toUtf8().data(), EMPTY);
+            uint node = frames.last().node;
+            const QList<uint> &nodeCallees = callees[node];
+            if (frames.last().nextCallee < nodeCallees.size())
+            {
+                uint callee = nodeCallees[frames.last().nextCallee++];
+                if (!indexes.contains(callee))
+                {
+                    Frame calleeFrame = { callee, 0 };
+                    frames.append(calleeFrame);
+                    indexes[callee] = lowLinks[callee] = nextIndex++;
+                    componentStack << callee;
+                    onComponentStack << callee;
+                }
+                else if (onComponentStack.contains(callee))
+                    lowLinks[node] = qMin(lowLinks[node], indexes[callee]);
+                continue;
+            }
+
+            frames.removeLast();
+            if (!frames.isEmpty())
+                lowLinks[frames.last().node] = qMin(lowLinks[frames.last().node], lowLinks[node]);
+
+            if (lowLinks[node] == indexes[node])
+            {
+                QList<uint> component;
+                uint member;
+                do
+                {
+                    member = componentStack.takeLast();
+                    onComponentStack.remove(member);
+                    component.prepend(member);
+                } while (member != node);
+
+                // Only mutual recursion groups and functions calling themselves are cycles
+                if (component.size() > 1 || selfCalls.contains(node))
+                {
+                    foreach (uint cycleMember, component)
+                        m_cycleOfNode.insert(cycleMember, m_cycles.size());
+                    m_cycles << component;
+                }
+            }
         }
-        sourceGraph = m_namedGraphs[absoluteContainer];
     }
-    absoluteContainer.clear();
-    foreach (const QString& container, targetContainers)
+
+    QStringList cycles;
+    foreach (const QList<uint> &cycle, m_cycles)
     {
-        Agraph_t *previousGraph = targetGraph;
-        absoluteContainer += container;
-        if (!m_namedGraphs.contains(absoluteContainer))
+        QStringList labels;
+        foreach (uint member, cycle)
+            labels << m_nodeLabels.value(member);
+        cycles << labels.join(", ");
+    }
+    emit cyclesFound(cycles);
+}
+
+void DotControlFlowGraph::highlightCycles()
+{
+    if (m_cycles.isEmpty() || m_collapseCycles)
+        return;
+
+    foreach (const QList<uint> &cycle, m_cycles)
+        foreach (uint member, cycle)
         {
-            Agraph_t *newGraph = agsubg(previousGraph, ("cluster_" + absoluteContainer).toUtf8().data(), 1);
-            m_namedGraphs.insert(absoluteContainer, newGraph);
-            agsafeset(newGraph, LABEL, container.toUtf8().data(), EMPTY);
+            Agnode_t *node = graphviz().agnode(m_rootGraph, QByteArray::number(member).data(), 0);
+            if (!node)
+                continue;
+            graphviz().agsafeset(node, COLOR, CYCLE_COLOR, EMPTY);
+            graphviz().agsafeset(node, PENWIDTH, CYCLE_PENWIDTH, EMPTY);
+
+            // Calls that stay inside the cycle
+            for (Agedge_t *edge = graphviz().agfstout(m_rootGraph, node); edge; edge = graphviz().agnxtout(m_rootGraph, edge))
+            {
+                bool ok;
+                uint callee = QByteArray(graphviz().agnameof(graphviz().aghead(edge))).toUInt(&ok);
+                if (ok && m_cycleOfNode.value(callee, -1) == m_cycleOfNode.value(member))
+                    graphviz().agsafeset(edge, COLOR, CYCLE_COLOR, EMPTY);
+            }
         }
-        targetGraph = m_namedGraphs[absoluteContainer];
+}
+
+void DotControlFlowGraph::resetGraph()
+{
+    if (m_rootGraph)
+    {
+        graphviz().agclose(m_rootGraph);
+        m_rootGraph = 0;
     }
 
-    Agnode_t* src = agnode(sourceGraph, (sourceContainers.join("") + source).toUtf8().data(), 1);
-    Agnode_t* tgt = agnode(targetGraph, (targetContainers.join("") + target).toUtf8().data(), 1);
+    m_layoutAborted = 0;
+    m_namedGraphs.clear();
+    m_collapsedNodes.clear();
+    m_summaryCounts.clear();
+    m_edgeMultiplicities.clear();
+    m_bufferMutex.lock();
+    m_aggregateEdges.clear();
+    m_bufferMutex.unlock();
+    if (!graphvizAvailable())
+        return;
+    // Graphs already handed over by graphDone belong to the pending and displayed buffers
+    m_rootGraph = graphviz().agopen(GRAPH_NAME, *graphviz().Agdirected, graphDiscipline());
+}
 
-    char color[8];
-    char ID[] = "id";
+void DotControlFlowGraph::drawElement(const GraphElement &element)
+{
+    Agraph_t *sourceGraph, *targetGraph;
+    bool sourceCollapsed = false, targetCollapsed = false;
+    Agnode_t *src = nodeFromContainers(element.sourceContainers, element.sourceId, element.source, sourceGraph, &sourceCollapsed);
 
-    QColor c = colorFromQualifiedIdentifier(source);
-    std::sprintf (color, "#%02x%02x%02x", c.red(), c.green(), c.blue());
-    agsafeset(src, STYLE, FILLED, EMPTY);
-    agsafeset(src, FILLCOLOR, color, EMPTY);
-    agsafeset(src, SHAPE, BOX, EMPTY);
-    agsafeset(src, LABEL, source.toUtf8().data(), EMPTY);
+    switch (element.type)
+    {
+        case GraphElement::RootNode:
+            break;
+        case GraphElement::FunctionCall:
+        {
+            Agnode_t *tgt = nodeFromContainers(element.targetContainers, element.targetId, element.target, targetGraph, &targetCollapsed);
+            Agraph_t *edgeGraph = (sourceGraph == targetGraph) ? sourceGraph:m_rootGraph;
+
+            // Calls inside a collapsed cluster disappear
+            if ((sourceCollapsed || targetCollapsed) && src == tgt)
+                break;
 
-    c = colorFromQualifiedIdentifier(target);
+            // Parallel calls are merged into a single edge weighted by the number of call sites
+            QString arc = QString::number(element.sourceId) + "->" + QString::number(element.targetId);
+            QString edgeId = (sourceCollapsed || targetCollapsed) ? QString(graphviz().agnameof(src)) + "->" + graphviz().agnameof(tgt) : arc;
+            Agedge_t *edge = graphviz().agedge(edgeGraph, src, tgt, NULL, 0);
+            if (!edge)
+            {
+                edge = graphviz().agedge(edgeGraph, src, tgt, NULL, 1);
+                graphviz().agsafeset(edge, ID, edgeId.toUtf8().data(), EMPTY);
+            }
+
+            // Edges to or from collapsed clusters and cycles stand for every call they replace
+            if (sourceCollapsed || targetCollapsed)
+            {
+                QMutexLocker locker(&m_bufferMutex);
+                if (!m_aggregateEdges[edgeId].contains(arc))
+                    m_aggregateEdges[edgeId] << arc;
+            }
+            int multiplicity = ++m_edgeMultiplicities[QString(graphviz().agnameof(src)) + "->" + graphviz().agnameof(tgt)];
+            graphviz().agsafeset(edge, MULTIPLICITY, QByteArray::number(multiplicity).data(), EMPTY);
+            graphviz().agsafeset(edge, PENWIDTH, QByteArray::number(qMin(1.0 + std::log(double(multiplicity)) / std::log(2.0), 5.0)).data(), EMPTY);
+            graphviz().agsafeset(edge, TOOLTIP, i18np("%1 call", "%1 calls", multiplicity).toUtf8().data(), EMPTY);
+            break;
+        }
+        case GraphElement::SummaryNode:
+        {
+            // A collapsed cluster already hides the callees of its functions
+            if (sourceCollapsed)
+                break;
+
+            // Several truncated functions may share the same node (class and namespace modes)
+            QByteArray summaryName = '+' + QByteArray::number(element.sourceId);
+            int count = m_summaryCounts[element.sourceId] += element.hiddenCallees;
+
+            Agnode_t *summary = graphviz().agnode(sourceGraph, summaryName.data(), 1);
+            graphviz().agsafeset(summary, SHAPE, NOTE, EMPTY);
+            graphviz().agsafeset(summary, STYLE, DASHED, EMPTY);
+            graphviz().agsafeset(summary, LABEL, i18np("+%1 more callee", "+%1 more callees", count).toUtf8().data(), EMPTY);
+
+            Agedge_t *edge = graphviz().agedge(sourceGraph, src, summary, NULL, 1);
+            graphviz().agsafeset(edge, STYLE, DASHED, EMPTY);
+            break;
+        }
+    }
+}
+
+Agnode_t *DotControlFlowGraph::nodeFromContainers(const QStringList &containers, uint id, const QString &label, Agraph_t *&graph, bool *collapsed)
+{
+    // Each collapsed recursion cycle is a single node, its members may belong to different clusters
+    if (m_collapseCycles && m_cycleOfNode.contains(id))
+    {
+        int cycle = m_cycleOfNode.value(id);
+        graph = m_rootGraph;
+        *collapsed = true;
+
+        QStringList labels;
+        foreach (uint member, m_cycles[cycle])
+            labels << m_nodeLabels.value(member);
+        Agnode_t *node = graphviz().agnode(graph, (CYCLE_PREFIX + QByteArray::number(cycle)).data(), 1);
+        setNodeAttributes(node, labels.first());
+        graphviz().agsafeset(node, LABEL, i18np("Recursion of %1 function:\n%2", "Recursion of %1 functions:\n%2",
+                                     labels.size(), labels.join("\n")).toUtf8().data(), EMPTY);
+        graphviz().agsafeset(node, SHAPE, BOX3D, EMPTY);
+        graphviz().agsafeset(node, COLOR, CYCLE_COLOR, EMPTY);
+        return node;
+    }
+
+    // Nodes inside a collapsed cluster are replaced by a single node standing for the whole cluster
+    QString absoluteContainer;
+    for (int i = 0; i < containers.size(); ++i)
+    {
+        absoluteContainer += containers[i];
+        if (m_collapsedClusters.contains(absoluteContainer))
+        {
+            graph = subgraphFromContainers(containers.mid(0, i));
+            QString nodeName = COLLAPSED_PREFIX + absoluteContainer;
+            m_collapsedNodes.insert(nodeName, absoluteContainer);
+            *collapsed = true;
+
+            Agnode_t *node = graphviz().agnode(graph, nodeName.toUtf8().data(), 1);
+            setNodeAttributes(node, containers[i]);
+            graphviz().agsafeset(node, SHAPE, BOX3D, EMPTY);
+            return node;
+        }
+    }
+
+    // Nodes are named after their interned ID, the label is only displayed
+    graph = subgraphFromContainers(containers);
+    Agnode_t *node = graphviz().agnode(graph, QByteArray::number(id).data(), 1);
+    setNodeAttributes(node, label);
+    return node;
+}
+
+void DotControlFlowGraph::setNodeAttributes(Agnode_t *node, const QString &label)
+{
+    QColor c = colorFromQualifiedIdentifier(label);
+    char color[8];
     std::sprintf (color, "#%02x%02x%02x", c.red(), c.green(), c.blue());
-    agsafeset(tgt, STYLE, FILLED, EMPTY);
-    agsafeset(tgt, FILLCOLOR, color, EMPTY);
-    agsafeset(tgt, SHAPE, BOX, EMPTY);
-    agsafeset(tgt, LABEL, target.toUtf8().data(), EMPTY);
-
-    Agedge_t* edge;
-    if (sourceGraph == targetGraph)
-        edge = agedge(sourceGraph, src, tgt, NULL, 1);
-    else
-        edge = agedge(m_rootGraph, src, tgt, NULL, 1);
-    agsafeset(edge, ID, (source + "->" + target).toUtf8().data(), EMPTY);
+    graphviz().agsafeset(node, STYLE, FILLED, EMPTY);
+    graphviz().agsafeset(node, FILLCOLOR, color, EMPTY);
+    graphviz().agsafeset(node, SHAPE, BOX, EMPTY);
+    graphviz().agsafeset(node, LABEL, label.toUtf8().data(), EMPTY);
+}
+
+Agraph_t *DotControlFlowGraph::subgraphFromContainers(const QStringList &containers)
+{
+    Agraph_t *graph = m_rootGraph;
+    QString absoluteContainer;
+
+    foreach (const QString& container, containers)
+    {
+        absoluteContainer += container;
+        if (!m_namedGraphs.contains(absoluteContainer))
+        {
+            Agraph_t *newGraph = graphviz().agsubg(graph, (CLUSTER_PREFIX + absoluteContainer).toUtf8().data(), 1);
+            m_namedGraphs.insert(absoluteContainer, newGraph);
+            graphviz().agsafeset(newGraph, LABEL, container.toUtf8().data(), EMPTY);
+        }
+        graph = m_namedGraphs[absoluteContainer];
+    }
+    return graph;
 }
 
 const QColor& DotControlFlowGraph::colorFromQualifiedIdentifier(const QString &label)
@@ -21,6 +21,8 @@
 #define DOTCONTROLFLOWGRAPH_H
 
 #include <QMap>
+#include <QSet>
+#include <QAtomicInt>
 #include <QHash>
 #include <QColor>
 #include <QMutex>
@@ -41,20 +43,93 @@ public:
     DotControlFlowGraph();
     virtual ~DotControlFlowGraph();
     static QMutex mutex;
+    static GVC_t *context();
+    static void releaseContext();
+    static bool graphvizAvailable();
+    static bool externalLayoutAvailable();
+
+    // Runs layout and rendering in a dot process that can be killed on abort or after timeout msecs
+    void setExternalLayout(bool externalLayout, int timeout = 30000);
+    bool externalLayout() const;
 Q_SIGNALS:
     bool loadLibrary(graph_t *rootGraph);
+    // Members of each recursion cycle found in the last graph
+    void cyclesFound(const QStringList &cycles);
 public Q_SLOTS:
     void prepareNewGraph();
-    void foundRootNode (const QStringList &containers, const QString &label);
-    void foundFunctionCall (const QStringList &sourceContainers, const QString &source, const QStringList &targetContainers, const QString &target);
+    void foundRootNode (const QStringList &containers, uint id, const QString &label);
+    void foundFunctionCall (const QStringList &sourceContainers, uint sourceId, const QString &source,
+                            const QStringList &targetContainers, uint targetId, const QString &target);
+    void foundSummaryNode (const QStringList &containers, uint id, const QString &source, int hiddenCallees);
     void graphDone();
     void clearGraph();
     void exportGraph(const QString &fileName);
+    void exportGraph(const QStringList &fileNames);
+
+    bool toggleCluster(const QString &elementName);
+    // Edges between the nodes an edge stands for, "sourceId->targetId", the edge itself unless it is aggregated
+    QStringList edgeMembers(const QString &edgeId);
+    void setClusterCollapsed(const QString &cluster, bool collapsed);
+    void setCyclesCollapsed(bool collapsed);
+    void abortLayout();
+private Q_SLOTS:
+    void swapBuffers();
 private:
-    GVC_t *m_gvc;
+    // Everything found so far, retained so that clusters can be collapsed without a new traversal
+    struct GraphElement
+    {
+        enum Type { RootNode, FunctionCall, SummaryNode };
+        GraphElement(Type type, const QStringList &sourceContainers, uint sourceId, const QString &source,
+                     const QStringList &targetContainers = QStringList(), uint targetId = 0, const QString &target = QString())
+        : type(type), sourceContainers(sourceContainers), sourceId(sourceId), source(source),
+          targetContainers(targetContainers), targetId(targetId), target(target), hiddenCallees(0) {}
+        Type type;
+        QStringList sourceContainers;
+        uint sourceId;
+        QString source;
+        QStringList targetContainers;
+        uint targetId;
+        QString target;
+        int hiddenCallees;
+    };
+
+    static GVC_t *s_gvc;
+    // Double buffering: m_rootGraph is being built, m_pendingGraph is finished and waits
+    // for the main thread, m_displayedGraph is the immutable snapshot loaded in the part
     Agraph_t *m_rootGraph;
+    Agraph_t *m_pendingGraph;
+    Agraph_t *m_displayedGraph;
+    // Snapshots replaced in the part, closed on the next graphDone rather than on the main thread
+    QList<Agraph_t *> m_retiredGraphs;
+    QMutex m_bufferMutex;
     QMap<QString, QColor> m_colorMap;
     QHash<QString, Agraph_t *> m_namedGraphs;
+    QHash<uint, int> m_summaryCounts;
+    QHash<QString, int> m_edgeMultiplicities;
+    QList<GraphElement> m_elements;
+    QSet<QString> m_collapsedClusters;
+    QHash<QString, QString> m_collapsedNodes;
+    QHash<QString, QStringList> m_aggregateEdges;
+    // Strongly connected components of the call graph, by node ID
+    QList< QList<uint> > m_cycles;
+    QHash<uint, int> m_cycleOfNode;
+    QHash<uint, QString> m_nodeLabels;
+    bool m_cyclesFound;
+    bool m_collapseCycles;
+    bool m_externalLayout;
+    int m_layoutTimeout;
+    QAtomicInt m_layoutAborted;
+
+    void resetGraph();
+    void redrawElements();
+    void findCycles();
+    void highlightCycles();
+    void closeRetiredGraphs();
+    bool runLayoutWorker(const QStringList &arguments, const QByteArray &input, QByteArray *output);
+    void drawElement(const GraphElement &element);
+    Agnode_t *nodeFromContainers(const QStringList &containers, uint id, const QString &label, Agraph_t *&graph, bool *collapsed);
+    void setNodeAttributes(Agnode_t *node, const QString &label);
+    Agraph_t *subgraphFromContainers(const QStringList &containers);
     const QColor& colorFromQualifiedIdentifier(const QString &label);
 };
 
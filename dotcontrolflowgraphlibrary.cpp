@@ -0,0 +1,85 @@
+/***************************************************************************
+ *   Copyright 2026 KDevelop developers                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "dotcontrolflowgraphlibrary.h"
+
+#include <QDebug>
+
+namespace {
+    // Soname major version shared by cgraph and gvc since Graphviz 2.30
+    const int GRAPHVIZ_SOVERSION = 6;
+}
+
+#define RESOLVE(library, symbol) resolve(library, #symbol, symbol)
+
+const DotControlFlowGraphLibrary *DotControlFlowGraphLibrary::self()
+{
+    static DotControlFlowGraphLibrary library;
+    return library.m_loaded ? &library : 0;
+}
+
+DotControlFlowGraphLibrary::DotControlFlowGraphLibrary()
+: m_loaded(false)
+{
+    m_loaded = load(m_cgraph, "cgraph") && load(m_gvc, "gvc") && resolveSymbols();
+}
+
+bool DotControlFlowGraphLibrary::load(QLibrary &library, const QString &name)
+{
+    // The unversioned name is only installed along with the development files
+    library.setFileNameAndVersion(name, GRAPHVIZ_SOVERSION);
+    if (library.load())
+        return true;
+    library.setFileName(name);
+    if (library.load())
+        return true;
+
+    qWarning() << "Could not load the Graphviz library" << name << ":" << library.errorString();
+    return false;
+}
+
+bool DotControlFlowGraphLibrary::resolveSymbols()
+{
+#ifdef HAVE_GRAPHVIZ_MEMDISC
+    // Older cgraph releases take the memory discipline as part of the graph discipline
+    if (!RESOLVE(m_cgraph, AgMemDisc))
+        return false;
+#endif
+    return RESOLVE(m_cgraph, agopen) && RESOLVE(m_cgraph, agclose) &&
+           RESOLVE(m_cgraph, agread) && RESOLVE(m_cgraph, agwrite) &&
+           RESOLVE(m_cgraph, agsubg) && RESOLVE(m_cgraph, agnode) &&
+           RESOLVE(m_cgraph, agedge) && RESOLVE(m_cgraph, agfstout) &&
+           RESOLVE(m_cgraph, agnxtout) && RESOLVE(m_cgraph, aghead) &&
+           RESOLVE(m_cgraph, agnameof) && RESOLVE(m_cgraph, agsafeset) &&
+           RESOLVE(m_cgraph, Agdirected) && RESOLVE(m_cgraph, AgIdDisc) &&
+           RESOLVE(m_cgraph, AgIoDisc) &&
+           RESOLVE(m_gvc, gvContext) && RESOLVE(m_gvc, gvFreeContext) &&
+           RESOLVE(m_gvc, gvLayout) && RESOLVE(m_gvc, gvFreeLayout) &&
+           RESOLVE(m_gvc, gvRenderFilename);
+}
+
+template <typename T>
+bool DotControlFlowGraphLibrary::resolve(QLibrary &library, const char *symbol, T &pointer)
+{
+    // Data symbols (graph descriptors and disciplines) are looked up the same way as functions
+    pointer = reinterpret_cast<T>(library.resolve(symbol));
+    if (!pointer)
+        qWarning() << "Could not resolve" << symbol << "in" << library.fileName();
+    return pointer;
+}
@@ -0,0 +1,76 @@
+/***************************************************************************
+ *   Copyright 2026 KDevelop developers                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef DOTCONTROLFLOWGRAPHLIBRARY_H
+#define DOTCONTROLFLOWGRAPHLIBRARY_H
+
+#include <QLibrary>
+#include <QString>
+
+#include <graphviz/gvc.h>
+
+/**
+ * Graphviz entry points used by the plugin, resolved through QLibrary the first time
+ * a graph is built or exported. The plugin itself does not link against Graphviz, so
+ * it still loads (and its analyses still work) when the libraries are missing.
+ */
+class DotControlFlowGraphLibrary
+{
+public:
+    // Loads the libraries on first call, returns 0 if they or one of the symbols are missing
+    static const DotControlFlowGraphLibrary *self();
+
+    decltype(&::agopen) agopen;
+    decltype(&::agclose) agclose;
+    decltype(&::agread) agread;
+    decltype(&::agwrite) agwrite;
+    decltype(&::agsubg) agsubg;
+    decltype(&::agnode) agnode;
+    decltype(&::agedge) agedge;
+    decltype(&::agfstout) agfstout;
+    decltype(&::agnxtout) agnxtout;
+    decltype(&::aghead) aghead;
+    decltype(&::agnameof) agnameof;
+    decltype(&::agsafeset) agsafeset;
+    decltype(&::Agdirected) Agdirected;
+    decltype(&::AgIdDisc) AgIdDisc;
+    decltype(&::AgIoDisc) AgIoDisc;
+#ifdef HAVE_GRAPHVIZ_MEMDISC
+    decltype(&::AgMemDisc) AgMemDisc;
+#endif
+
+    decltype(&::gvContext) gvContext;
+    decltype(&::gvFreeContext) gvFreeContext;
+    decltype(&::gvLayout) gvLayout;
+    decltype(&::gvFreeLayout) gvFreeLayout;
+    decltype(&::gvRenderFilename) gvRenderFilename;
+
+private:
+    DotControlFlowGraphLibrary();
+
+    bool load(QLibrary &library, const QString &name);
+    bool resolveSymbols();
+    template <typename T> bool resolve(QLibrary &library, const char *symbol, T &pointer);
+
+    QLibrary m_cgraph;
+    QLibrary m_gvc;
+    bool m_loaded;
+};
+
+#endif
@@ -20,6 +20,11 @@
 #include "duchaincontrolflow.h"
 
 #include <limits>
+#include <algorithm>
+
+#include <QThread>
+#include <QElapsedTimer>
+#include <QtConcurrentMap>
 
 #include <KTextEditor/View>
 #include <KTextEditor/Document>
@@ -49,32 +54,50 @@
 
 #include "dotcontrolflowgraph.h"
 #include "duchaincontrolflowjob.h"
-#include "controlflowgraphusescollector.h"
+#include "controlflowgraphcache.h"
+#include "controlflowgraphclasshierarchy.h"
 #include "controlflowgraphnavigationwidget.h"
 
 Q_DECLARE_METATYPE(KDevelop::Use)
 
 using namespace KDevelop;
 
+namespace {
+    // Milliseconds a traversal may keep the DUChain read locked before letting writers in
+    const int lockSlice = 50;
+}
+
 DUChainControlFlow::DUChainControlFlow(DotControlFlowGraph* dotControlFlowGraph)
 : m_dotControlFlowGraph(dotControlFlowGraph),
   m_previousUppermostExecutableContext(IndexedDUContext()),
   m_currentView(0),
+  m_drawnFunctionCalls(0),
+  m_redrawPending(false),
   m_currentProject(0),
-  m_currentLevel(1),
+  m_edgeCount(0),
+  m_nodeCount(0),
+  m_maxCallPaths(5),
+  m_cache(0),
+  m_classHierarchy(0),
   m_maxLevel(2),
+  m_maxNodes(0),
+  m_maxEdges(0),
+  m_levelBudget(0),
   m_locked(false),
   m_drawIncomingArcs(true),
+  m_expandOverrides(false),
   m_useFolderName(true),
   m_useShortNames(true),
   m_ShowUsesOnEdgeHover(true),
   m_controlFlowMode(ControlFlowClass),
   m_clusteringModes(ClusteringNamespace),
   m_graphThreadRunning(false),
+  m_restartPending(false),
   m_abort(false),
   m_collector(0)
 {
     qRegisterMetaType<Use>("Use");
+    qRegisterMetaType<ControlFlowGraphUsesCollector::CallSites>("ControlFlowGraphUsesCollector::CallSites");
 }
 
 DUChainControlFlow::~DUChainControlFlow()
@@ -100,6 +123,7 @@ DUChainControlFlow::ClusteringModes DUChainControlFlow::clusteringModes() const
 
 void DUChainControlFlow::generateControlFlowForDeclaration(IndexedDeclaration idefinition, IndexedTopDUContext itopContext, IndexedDUContext iuppermostExecutableContext)
 {
+    updateClassHierarchy();
     DUChainReadLocker lock(DUChain::lock());
 
     Declaration *definition = idefinition.data();
@@ -114,47 +138,166 @@ void DUChainControlFlow::generateControlFlowForDeclaration(IndexedDeclaration id
     if (!uppermostExecutableContext)
         return;
 
-    // Convert to a declaration in accordance with control flow mode (function, class or namespace)
-    Declaration *nodeDefinition = declarationFromControlFlowMode(definition);
+    // The function-level graph is retained, class and namespace graphs are projected from it in drawGraph
+    if (m_maxLevel != 1 && !m_graph.visitedFunctions.contains(idefinition) && definition->internalContext())
+    {
+        traverseRoot(m_graph, idefinition, iuppermostExecutableContext, lock, m_levelBudget);
 
-    QStringList containers;
-    prepareContainers(containers, definition);
+        // The chain may have changed while the intermediate graphs were drawn
+        definition = idefinition.data();
+        topContext = itopContext.data();
+        if (!definition || !topContext)
+            return;
+    }
 
-    QString shortName = shortNameFromContainers(containers, prependFolderNames(nodeDefinition));
+    if (m_abort)
+        return;
+
+    if (m_drawIncomingArcs)
+        collectIncomingCalls(definition, topContext);
+}
 
-    if (m_maxLevel != 1 && !m_visitedFunctions.contains(idefinition) && nodeDefinition && nodeDefinition->internalContext())
+void DUChainControlFlow::traverseRoot(CallGraph &graph, const IndexedDeclaration &idefinition, const IndexedDUContext &icontext,
+                                      DUChainReadLocker &lock, int levelBudget)
+{
+    QElapsedTimer lockTimer;
+    lockTimer.start();
+
+    graph.rootFunctions << idefinition;
+    retainFunctionInfo(graph, idefinition.data());
+    graph.visitedFunctions.insert(idefinition);
+    insertGraphNode(graph, idefinition);
+
+    // Expand functions level by level, so that the graph budget always truncates the farthest calls
+    QList<PendingFunction> currentLevel;
+    currentLevel << PendingFunction(idefinition, icontext, 1);
+    QElapsedTimer levelTimer;
+    levelTimer.start();
+    for (int level = 1; !currentLevel.isEmpty() && !m_abort; ++level)
     {
-        m_dotControlFlowGraph->foundRootNode(containers, (m_controlFlowMode == ControlFlowNamespace &&
-                                        nodeDefinition->internalContext() && nodeDefinition->internalContext()->type() != DUContext::Namespace) ?
-                                                                          globalNamespaceOrFolderNames(nodeDefinition):
-                                                                          shortName);
-        ++m_currentLevel;
-        m_visitedFunctions.insert(idefinition);
-        m_identifierDeclarationMap[containers.join("") + shortName] = IndexedDeclaration(nodeDefinition);
-        useDeclarationsFromDefinition(definition, topContext, uppermostExecutableContext);
+        // Within a level, functions called more often are expanded first
+        std::stable_sort(currentLevel.begin(), currentLevel.end(),
+                         [](const PendingFunction &a, const PendingFunction &b) { return a.multiplicity > b.multiplicity; });
+
+        QList<PendingFunction> nextLevel;
+        foreach (const PendingFunction &pending, currentLevel)
+        {
+            if (m_abort)
+                break;
+
+            // Pending functions are indexed, so they survive the lock being yielded between them
+            Declaration *function = pending.definition.data();
+            DUContext *context = pending.context.data();
+            if (function && context)
+                expandFunction(graph, function, context, level, nextLevel);
+            yieldLock(lock, lockTimer);
+        }
+        currentLevel = nextLevel;
+
+        // Show each level as soon as it is known and only go deeper while the budget lasts
+        if (levelBudget > 0 && !currentLevel.isEmpty() && !m_abort)
+        {
+            if (levelTimer.hasExpired(levelBudget))
+                break;
+            lock.unlock();
+            drawGraph();
+            m_dotControlFlowGraph->graphDone();
+            lock.lock();
+            lockTimer.start();
+        }
     }
+}
 
+void DUChainControlFlow::generateControlFlowForDeclarations(const QList<IndexedDeclaration> &definitions)
+{
+    // Each root is traversed into a graph of its own, on whichever pool thread is idle first
+    QList<PartialRoot> roots;
+    foreach (const IndexedDeclaration &definition, definitions)
+        roots << PartialRoot(definition);
+    updateClassHierarchy();
+    QtConcurrent::blockingMap(roots, [this](PartialRoot &root) { traversePartialRoot(root); });
     if (m_abort)
         return;
 
-    if (m_drawIncomingArcs)
-    {
-        Declaration *declaration = definition;
-        if (declaration->isDefinition())
-            declaration = DUChainUtils::declarationForDefinition(declaration, topContext);
+    // Partial graphs are merged in the order of their roots, call sites reached from several roots are kept once
+    typedef QPair<CallEdge, QPair<IndexedString, QPair<int, int> > > CallSiteKey;
+    m_retainedGraphMutex.lock();
+    QSet<CallSiteKey> callSites;
+    foreach (const FunctionCall &functionCall, m_graph.functionCalls)
+        callSites.insert(qMakePair(qMakePair(functionCall.source, functionCall.target),
+                                   qMakePair(functionCall.url, qMakePair(functionCall.range.start.line, functionCall.range.start.column))));
 
-        if (declaration)
+    foreach (const PartialRoot &root, roots)
+    {
+        foreach (const IndexedDeclaration &rootFunction, root.graph.rootFunctions)
+            if (!m_graph.rootFunctions.contains(rootFunction))
+                m_graph.rootFunctions << rootFunction;
+        foreach (const FunctionCall &functionCall, root.graph.functionCalls)
         {
-            delete m_collector;
-            m_collector = new ControlFlowGraphUsesCollector(declaration);
-            m_collector->setProcessDeclarations(true);
-            connect(m_collector, SIGNAL(processFunctionCall(Declaration*, Declaration*, Use)), SLOT(processFunctionCall(Declaration*, Declaration*, Use)));
-            m_collector->startCollecting();
+            CallSiteKey callSite = qMakePair(qMakePair(functionCall.source, functionCall.target),
+                                             qMakePair(functionCall.url, qMakePair(functionCall.range.start.line, functionCall.range.start.column)));
+            if (callSites.contains(callSite))
+                continue;
+            callSites.insert(callSite);
+            m_graph.functionCalls << functionCall;
         }
+        for (QHash<IndexedDeclaration, FunctionInfo>::const_iterator info = root.graph.functionInfos.constBegin(); info != root.graph.functionInfos.constEnd(); ++info)
+            if (!m_graph.functionInfos.contains(info.key()))
+                m_graph.functionInfos.insert(info.key(), info.value());
+        for (QHash<IndexedDeclaration, int>::const_iterator hidden = root.graph.hiddenCallees.constBegin(); hidden != root.graph.hiddenCallees.constEnd(); ++hidden)
+            m_graph.hiddenCallees[hidden.key()] = qMax(m_graph.hiddenCallees.value(hidden.key()), hidden.value());
+        m_graph.visitedFunctions.unite(root.graph.visitedFunctions);
+        m_graph.graphNodes.unite(root.graph.graphNodes);
     }
+    m_retainedGraphMutex.unlock();
 
-    m_dotControlFlowGraph->graphDone();
-    m_currentLevel = 1;
+    // A single collector is kept, as when the roots are generated one after another
+    if (m_drawIncomingArcs && !roots.isEmpty())
+    {
+        DUChainReadLocker lock(DUChain::lock());
+        Declaration *definition = roots.last().definition.data();
+        if (definition && definition->topContext())
+            collectIncomingCalls(definition, definition->topContext());
+    }
+}
+
+void DUChainControlFlow::traversePartialRoot(PartialRoot &root)
+{
+    // Roots still queued when the traversal is aborted are skipped
+    if (m_abort || m_maxLevel == 1)
+        return;
+
+    DUChainReadLocker lock(DUChain::lock());
+    Declaration *definition = root.definition.data();
+    if (!definition || !definition->internalContext())
+        return;
+
+    // Partial graphs are only drawn once merged, but they share the node and edge budget while traversing
+    traverseRoot(root.graph, root.definition, IndexedDUContext(definition->internalContext()), lock, 0);
+}
+
+void DUChainControlFlow::updateClassHierarchy()
+{
+    // The hierarchy is only built once overrides are expanded, from the job rather than the GUI thread
+    if (m_expandOverrides && m_classHierarchy)
+        m_classHierarchy->update();
+}
+
+void DUChainControlFlow::collectIncomingCalls(Declaration *definition, TopDUContext *topContext)
+{
+    Declaration *declaration = definition;
+    if (declaration->isDefinition())
+        declaration = DUChainUtils::declarationForDefinition(declaration, topContext);
+
+    if (declaration)
+    {
+        delete m_collector;
+        m_collector = new ControlFlowGraphUsesCollector(declaration);
+        m_collector->setProcessDeclarations(true);
+        connect(m_collector, SIGNAL(processFunctionCalls(KDevelop::IndexedString, ControlFlowGraphUsesCollector::CallSites)),
+                SLOT(processFunctionCalls(KDevelop::IndexedString, ControlFlowGraphUsesCollector::CallSites)));
+        m_collector->startCollecting();
+    }
 }
 
 bool DUChainControlFlow::isLocked()
@@ -164,189 +307,426 @@ bool DUChainControlFlow::isLocked()
 
 void DUChainControlFlow::run()
 {
+    // generateControlFlowForDeclaration locks by itself, so that it can release the lock while drawing
+    m_abort = false;
+    generateControlFlowForDeclaration(m_definition, m_topContext, m_uppermostExecutableContext);
+    // A cancelled job keeps the graph currently displayed
+    if (m_abort)
+        return;
+    drawGraph();
+    m_dotControlFlowGraph->graphDone();
+}
+
+void DUChainControlFlow::runCallPaths()
+{
+    updateClassHierarchy();
     DUChainReadLocker lock(DUChain::lock());
 
     m_abort = false;
-    generateControlFlowForDeclaration(m_definition, m_topContext, m_uppermostExecutableContext);
+    QHash<CallEdge, FunctionCall> edges;
+    QList<CallPath> paths = searchCallPaths(m_callPathSource, m_callPathTarget, m_maxCallPaths, &edges);
+    if (m_abort)
+        return;
+
+    // Both ends are shown even when no path exists, the graph is the union of the paths
+    m_graph.rootFunctions << m_callPathSource << m_callPathTarget;
+    if (Declaration *source = m_callPathSource.data())
+        retainFunctionInfo(m_graph, source);
+    if (Declaration *target = m_callPathTarget.data())
+        retainFunctionInfo(m_graph, target);
+
+    QSet<CallEdge> pathEdges;
+    foreach (const CallPath &path, paths)
+        for (int i = 0; i + 1 < path.size(); ++i)
+        {
+            CallEdge edge(path[i], path[i + 1]);
+            if (pathEdges.contains(edge) || !path[i].data() || !path[i + 1].data())
+                continue;
+            pathEdges.insert(edge);
+
+            m_retainedGraphMutex.lock();
+            m_graph.functionCalls << edges[edge];
+            m_retainedGraphMutex.unlock();
+            retainFunctionInfo(m_graph, path[i].data());
+            retainFunctionInfo(m_graph, path[i + 1].data());
+        }
+
+    lock.unlock();
+    drawGraph();
+    m_dotControlFlowGraph->graphDone();
 }
 
-void DUChainControlFlow::cursorPositionChanged(KTextEditor::View *view, const KTextEditor::Cursor &cursor)
+void DUChainControlFlow::requestAbort()
 {
-    if (!m_graphThreadRunning)
+    m_abort = true;
+    if (m_dotControlFlowGraph)
+        m_dotControlFlowGraph->abortLayout();
+}
+
+void DUChainControlFlow::drawGraph()
+{
+    // Node and edge lookups from the view may run while the job draws intermediate graphs
+    QMutexLocker drawnGraphLocker(&m_drawnGraphMutex);
+    m_identifierDeclarationMap.clear();
+    m_arcUsesMap.clear();
+    m_arcLabels.clear();
+    m_summaryNodes.clear();
+    m_declarationNodeIds.clear();
+    m_namedNodeIds.clear();
+    m_dotControlFlowGraph->prepareNewGraph();
+
+    // Incoming arcs may still be recorded by the uses collector from the main thread
+    m_retainedGraphMutex.lock();
+    QList<FunctionCall> functionCalls = m_graph.functionCalls;
+    QHash<IndexedDeclaration, FunctionInfo> functionInfos = m_graph.functionInfos;
+    m_retainedGraphMutex.unlock();
+    m_drawnFunctionCalls = functionCalls.size();
+
+    // Labels are generated from the retained function information only, no DUChain access is needed
+    foreach (const IndexedDeclaration &irootFunction, m_graph.rootFunctions)
     {
-        if (m_locked) return;
-        if (!view->document()) return;
+        const FunctionInfo &functionInfo = functionInfos[irootFunction];
+        const DeclarationInfo &nodeInfo = functionInfo.projections[m_controlFlowMode];
 
-        DUChainReadLocker lock(DUChain::lock());
+        QStringList containers;
+        prepareContainers(containers, functionInfo);
 
-        TopDUContext *topContext = DUChainUtils::standardContextForUrl(view->document()->url());
-        if (!topContext) return;
+        QString label = labelFromControlFlowMode(functionInfo, containers);
+        uint id = nodeId(functionInfo, containers, label);
 
-        DUContext *context = topContext->findContextAt(topContext->transformToLocalRevision(cursor));
+        m_dotControlFlowGraph->foundRootNode(containers, id, label);
+        m_identifierDeclarationMap[id] = nodeInfo.declaration;
+    }
 
-        if (!context)
-        {
-            newGraph();
-            m_previousUppermostExecutableContext = IndexedDUContext();
-            return;
-        }
+    foreach (const FunctionCall &functionCall, functionCalls)
+        drawFunctionCall(functionCall, functionInfos[functionCall.source], functionInfos[functionCall.target]);
 
-        // If cursor is in a method arguments context change it to internal context
-        if (context && context->type() == DUContext::Function && context->importers().size() == 1)
-            context = context->importers()[0];
+    QHash<IndexedDeclaration, int>::const_iterator hiddenCalleesIterator = m_graph.hiddenCallees.constBegin();
+    for (; hiddenCalleesIterator != m_graph.hiddenCallees.constEnd(); ++hiddenCalleesIterator)
+    {
+        const FunctionInfo &functionInfo = functionInfos[hiddenCalleesIterator.key()];
+
+        QStringList containers;
+        prepareContainers(containers, functionInfo);
+        QString label = labelFromControlFlowMode(functionInfo, containers);
+        uint id = nodeId(functionInfo, containers, label);
+        m_dotControlFlowGraph->foundSummaryNode(containers, id, label, hiddenCalleesIterator.value());
+        m_summaryNodes[id] << hiddenCalleesIterator.key();
+    }
+}
 
-        auto declarationUnderCursor = DUChainUtils::itemUnderCursor(view->document()->url(), cursor);
-        if ( (!context || context->type() != DUContext::Other) && declarationUnderCursor.context )
-            context = declarationUnderCursor.context;
+void DUChainControlFlow::cursorPositionChanged(KTextEditor::View *view, const KTextEditor::Cursor &cursor)
+{
+    if (m_locked) return;
+    if (!view->document()) return;
 
-        if (!context || context->type() != DUContext::Other)
-        {
-            // If there is a previous graph
-            if (!(m_previousUppermostExecutableContext == IndexedDUContext()))
-            {
-                newGraph();
-                m_previousUppermostExecutableContext = IndexedDUContext();
-            }
+    DUChainReadLocker lock(DUChain::lock());
+
+    TopDUContext *topContext = DUChainUtils::standardContextForUrl(view->document()->url());
+    if (!topContext) return;
+
+    DUContext *context = topContext->findContextAt(topContext->transformToLocalRevision(cursor));
+
+    if (!context)
+    {
+        if (restartJob())
             return;
-        }
+        newGraph();
+        m_previousUppermostExecutableContext = IndexedDUContext();
+        return;
+    }
 
-        m_currentContext = IndexedDUContext(context);
-        m_currentView = view;
-        m_topContext = IndexedTopDUContext(topContext);
+    // If cursor is in a method arguments context change it to internal context
+    if (context && context->type() == DUContext::Function && context->importers().size() == 1)
+        context = context->importers()[0];
 
-        m_currentProject = ICore::self()->projectController()->findProjectForUrl(m_currentView->document()->url());
-        m_includeDirectories.clear();
+    auto declarationUnderCursor = DUChainUtils::itemUnderCursor(view->document()->url(), cursor);
+    if ( (!context || context->type() != DUContext::Other) && declarationUnderCursor.context )
+        context = declarationUnderCursor.context;
 
-        // Invoke includeDirectories in advance. Running it in the background thread may crash because
-        // of thread-safety issues in KConfig / CMakeUtils.
-        if (m_currentProject)
+    if (!context || context->type() != DUContext::Other)
+    {
+        // If there is a previous graph
+        if (!(m_previousUppermostExecutableContext == IndexedDUContext()))
         {
-            KDevelop::ProjectBaseItem *project_item = m_currentProject->projectItem();
-            IBuildSystemManager *buildSystemManager = 0;
-            if (project_item && (buildSystemManager = m_currentProject->buildSystemManager()))
-                m_includeDirectories = buildSystemManager->includeDirectories(project_item);
+            if (restartJob())
+                return;
+            newGraph();
+            m_previousUppermostExecutableContext = IndexedDUContext();
         }
+        return;
+    }
 
-        // Navigate to uppermost executable context
-        DUContext *uppermostExecutableContext = m_currentContext.data();
-        if (!uppermostExecutableContext)
-            return;
+    // Navigate to uppermost executable context
+    DUContext *uppermostExecutableContext = context;
+    while (uppermostExecutableContext->parentContext() && uppermostExecutableContext->parentContext()->type() == DUContext::Other)
+        uppermostExecutableContext = uppermostExecutableContext->parentContext();
 
-        while (uppermostExecutableContext->parentContext() && uppermostExecutableContext->parentContext()->type() == DUContext::Other)
-            uppermostExecutableContext = uppermostExecutableContext->parentContext();
+    // If cursor is in the same function definition, a running job keeps deepening its graph
+    if (IndexedDUContext(uppermostExecutableContext) == m_previousUppermostExecutableContext)
+        return;
 
-        // If cursor is in the same function definition
-        if (IndexedDUContext(uppermostExecutableContext) == m_previousUppermostExecutableContext)
-            return;
+    // The graph of another function is still being built, it is dropped and the job restarted once it stops
+    if (restartJob())
+        return;
 
-        m_previousUppermostExecutableContext = IndexedDUContext(uppermostExecutableContext);
+    m_currentContext = IndexedDUContext(context);
+    m_currentView = view;
+    m_topContext = IndexedTopDUContext(topContext);
 
-        // Get the definition
-        Declaration* definition = 0;
-        if (!uppermostExecutableContext || !uppermostExecutableContext->owner())
-            return;
-        else
-            definition = uppermostExecutableContext->owner();
+    m_currentProject = ICore::self()->projectController()->findProjectForUrl(m_currentView->document()->url());
+    m_includeDirectories.clear();
 
-        if (!definition) return;
+    // Invoke includeDirectories in advance. Running it in the background thread may crash because
+    // of thread-safety issues in KConfig / CMakeUtils.
+    if (m_currentProject)
+    {
+        KDevelop::ProjectBaseItem *project_item = m_currentProject->projectItem();
+        IBuildSystemManager *buildSystemManager = 0;
+        if (project_item && (buildSystemManager = m_currentProject->buildSystemManager()))
+            m_includeDirectories = buildSystemManager->includeDirectories(project_item);
+    }
 
-        newGraph();
-        m_dotControlFlowGraph->prepareNewGraph();
+    m_previousUppermostExecutableContext = IndexedDUContext(uppermostExecutableContext);
+
+    // Get the definition
+    Declaration* definition = 0;
+    if (!uppermostExecutableContext->owner())
+        return;
+    else
+        definition = uppermostExecutableContext->owner();
+
+    if (!definition) return;
 
-        m_definition = IndexedDeclaration(definition);
-        m_uppermostExecutableContext = IndexedDUContext(uppermostExecutableContext);
+    // Summary nodes expanded by the user only make sense for the same root function
+    if (!(IndexedDeclaration(definition) == m_definition))
+        m_expandedFunctions.clear();
 
-        m_graphThreadRunning = true;
-        DUChainControlFlowJob *job = new DUChainControlFlowJob(context->scopeIdentifier().toString(), this);
-        connect (job, SIGNAL(result(KJob*)), SLOT(jobDone(KJob*)));
+    newGraph();
+    m_dotControlFlowGraph->prepareNewGraph();
+
+    m_definition = IndexedDeclaration(definition);
+    m_uppermostExecutableContext = IndexedDUContext(uppermostExecutableContext);
+
+    m_graphThreadRunning = true;
+    DUChainControlFlowJob *job = new DUChainControlFlowJob(context->scopeIdentifier().toString(), this);
+    connect (job, SIGNAL(result(KJob*)), SLOT(jobDone(KJob*)));
 	emit startingJob();
 	ICore::self()->runController()->registerJob(job);
-    }
-    else {
-        qDebug() << "Control flow thread already running";
-    }
 }
 
-void DUChainControlFlow::processFunctionCall(Declaration *source, Declaration *target, const Use &use)
+bool DUChainControlFlow::restartJob()
 {
-    FunctionDefinition *calledFunctionDefinition;
-    DUContext *calledFunctionContext;
+    if (!m_graphThreadRunning)
+        return false;
 
+    // jobDone follows the cursor with a new job once the running one has given up
+    m_restartPending = true;
+    requestAbort();
+    return true;
+}
+
+void DUChainControlFlow::processFunctionCall(Declaration *source, Declaration *target, const Use &use)
+{
     DUChainReadLocker lock(DUChain::lock());
+    processFunctionCall(m_graph, source, target, use);
+}
+
+void DUChainControlFlow::processFunctionCall(CallGraph &graph, Declaration *source, Declaration *target, const Use &use)
+{
+    if (callFilterAction(target) == ControlFlowGraphCallFilter::Hide)
+        return;
 
-    // Convert to a declaration in accordance with control flow mode (function, class or namespace)
-    Declaration *nodeSource = declarationFromControlFlowMode(source);
-    Declaration *nodeTarget = declarationFromControlFlowMode(target);
+    FunctionCall functionCall;
+    functionCall.source = IndexedDeclaration(source);
+    functionCall.target = IndexedDeclaration(target);
+    functionCall.range = use.m_range;
+    functionCall.url = source->url();
+    functionCall.incoming = false;
+
+    m_retainedGraphMutex.lock();
+    graph.functionCalls << functionCall;
+    m_retainedGraphMutex.unlock();
+    retainFunctionInfo(graph, source);
+    retainFunctionInfo(graph, target);
+}
 
-    // Try to acquire the called function definition
-    calledFunctionDefinition = FunctionDefinition::definition(target);
+void DUChainControlFlow::processFunctionCalls(const IndexedString &url, const ControlFlowGraphUsesCollector::CallSites &callSites)
+{
+    // Incoming calls arrive one file at a time, so labels are resolved under a single lock
+    DUChainReadLocker lock(DUChain::lock());
 
-    QStringList sourceContainers, targetContainers;
+    QList<FunctionCall> functionCalls;
+    QSet<IndexedDeclaration> functions;
+    foreach (const ControlFlowGraphUsesCollector::CallSite &callSite, callSites)
+    {
+        if (!callSite.source.data() || !callSite.target.data())
+            continue;
+        if (callFilterAction(callSite.source.data()) == ControlFlowGraphCallFilter::Hide)
+            continue;
+
+        FunctionCall functionCall;
+        functionCall.source = callSite.source;
+        functionCall.target = callSite.target;
+        functionCall.range = callSite.range;
+        functionCall.url = url;
+        functionCall.incoming = true;
+        functionCalls << functionCall;
+        functions << callSite.source << callSite.target;
+    }
 
-    prepareContainers(sourceContainers, source);
-    prepareContainers(targetContainers, target);
+    m_retainedGraphMutex.lock();
+    m_graph.functionCalls << functionCalls;
+    m_retainedGraphMutex.unlock();
+    foreach (const IndexedDeclaration &function, functions)
+        retainFunctionInfo(m_graph, function.data());
 
-    QString sourceLabel = shortNameFromContainers(sourceContainers,
-                          (m_controlFlowMode == ControlFlowNamespace &&
-                           (nodeSource->internalContext() && nodeSource->internalContext()->type() != DUContext::Namespace)) ?
-                                            globalNamespaceOrFolderNames(nodeSource) :
-                                            prependFolderNames(nodeSource));
+    // Uses found after the graph was drawn are shown by a single deferred redraw
+    if (!m_graphThreadRunning && !m_redrawPending)
+    {
+        m_redrawPending = true;
+        QMetaObject::invokeMethod(this, "redrawGraph", Qt::QueuedConnection);
+    }
+}
+
+void DUChainControlFlow::drawFunctionCall(const FunctionCall &functionCall, const FunctionInfo &sourceInfo, const FunctionInfo &targetInfo)
+{
+    QStringList sourceContainers, targetContainers;
 
-    QString targetLabel = shortNameFromContainers(targetContainers,
-                          (m_controlFlowMode == ControlFlowNamespace &&
-                           (nodeTarget->internalContext() && nodeTarget->internalContext()->type() != DUContext::Namespace)) ?
-                                            globalNamespaceOrFolderNames(nodeTarget) :
-                                            prependFolderNames(nodeTarget));
+    prepareContainers(sourceContainers, sourceInfo);
+    prepareContainers(targetContainers, targetInfo);
 
-    QString sourceShortName = shortNameFromContainers(sourceContainers, prependFolderNames(nodeSource));
-    QString targetShortName = shortNameFromContainers(targetContainers, prependFolderNames(nodeTarget));
+    QString sourceLabel = labelFromControlFlowMode(sourceInfo, sourceContainers);
+    QString targetLabel = labelFromControlFlowMode(targetInfo, targetContainers);
 
-    if (sender() && dynamic_cast<ControlFlowGraphUsesCollector *>(sender()))
+    uint targetId = nodeId(targetInfo, targetContainers, targetLabel);
+    uint sourceId;
+    if (functionCall.incoming)
     {
         sourceContainers.prepend(i18n("Uses of %1", targetLabel));
-        m_identifierDeclarationMap[sourceContainers.join("") + sourceShortName] = IndexedDeclaration(nodeSource);
+        sourceId = nodeId(sourceInfo, sourceContainers, sourceLabel, targetId);
+        m_identifierDeclarationMap[sourceId] = sourceInfo.projections[m_controlFlowMode].declaration;
     }
+    else
+        sourceId = nodeId(sourceInfo, sourceContainers, sourceLabel);
 
-    IndexedDeclaration ideclaration = IndexedDeclaration(calledFunctionDefinition);
-    m_dotControlFlowGraph->foundFunctionCall(sourceContainers, sourceLabel, targetContainers, targetLabel);
+    m_dotControlFlowGraph->foundFunctionCall(sourceContainers, sourceId, sourceLabel, targetContainers, targetId, targetLabel);
 
-    if (calledFunctionDefinition)
-        calledFunctionContext = calledFunctionDefinition->internalContext();
-    else
+    // Store use for edge inspection, edges are identified by their nodes since labels may be shared
+    QString arc = QString::number(sourceId) + "->" + QString::number(targetId);
+    QPair<RangeInRevision, IndexedString> pair(functionCall.range, functionCall.url);
+    if (!m_arcUsesMap.values(arc).contains(pair))
+        m_arcUsesMap.insertMulti(arc, pair);
+    m_arcLabels.insert(arc, sourceLabel + "->" + targetLabel);
+
+    // Store method definition (or declaration, if no definition is available) for navigation
+    m_identifierDeclarationMap[targetId] = (m_controlFlowMode == ControlFlowFunction && targetInfo.definition.isValid()) ?
+                                                                              targetInfo.definition :
+                                                                              targetInfo.projections[m_controlFlowMode].declaration;
+}
+
+void DUChainControlFlow::retainFunctionInfo(CallGraph &graph, Declaration *declaration)
+{
+    IndexedDeclaration ideclaration(declaration);
+
+    m_retainedGraphMutex.lock();
+    bool retained = graph.functionInfos.contains(ideclaration);
+    m_retainedGraphMutex.unlock();
+    if (retained)
+        return;
+
+    FunctionInfo functionInfo;
+    if (m_cache && m_cache->functionInfo(ideclaration, functionInfo))
     {
-        // Store method declaration for navigation
-        m_identifierDeclarationMap[targetContainers.join("") + targetShortName] = IndexedDeclaration(nodeTarget);
-        // Store use for edge inspection
-        QPair<RangeInRevision, IndexedString> pair(use.m_range, source->url());
-        if (!m_arcUsesMap.values(sourceLabel + "->" + targetLabel).contains(pair))
-            m_arcUsesMap.insertMulti(sourceLabel + "->" + targetLabel, pair);
+        m_retainedGraphMutex.lock();
+        graph.functionInfos.insert(ideclaration, functionInfo);
+        m_retainedGraphMutex.unlock();
         return;
     }
 
-    // Store use for edge inspection
-    QPair<RangeInRevision, IndexedString> pair(use.m_range, source->url());
-    if (!m_arcUsesMap.values(sourceLabel + "->" + targetLabel).contains(pair))
-        m_arcUsesMap.insertMulti(sourceLabel + "->" + targetLabel, pair);
-    // Store method definition for navigation
-    m_identifierDeclarationMap[targetContainers.join("") + targetShortName] = IndexedDeclaration(declarationFromControlFlowMode(calledFunctionDefinition));
+    for (int mode = ControlFlowFunction; mode <= ControlFlowNamespace; ++mode)
+    {
+        // Convert to a declaration in accordance with each control flow mode (function, class or namespace)
+        Declaration *nodeDeclaration = declarationFromControlFlowMode(declaration, ControlFlowMode(mode));
+        DeclarationInfo &nodeInfo = functionInfo.projections[mode];
+        nodeInfo.declaration = IndexedDeclaration(nodeDeclaration);
+        // Definitions and call targets of the same function must end up in the same node
+        Declaration *identityDeclaration = nodeDeclaration->isDefinition() ?
+                                           DUChainUtils::declarationForDefinition(nodeDeclaration, nodeDeclaration->topContext()) : 0;
+        nodeInfo.identity = IndexedDeclaration(identityDeclaration ? identityDeclaration : nodeDeclaration);
+        nodeInfo.qualifiedIdentifier = nodeDeclaration->qualifiedIdentifier().toString();
+        nodeInfo.url = nodeDeclaration->url().str();
+        nodeInfo.hasInternalContext = nodeDeclaration->internalContext();
+        nodeInfo.internalContextType = nodeInfo.hasInternalContext ? nodeDeclaration->internalContext()->type() : DUContext::Other;
+    }
+
+    FunctionDefinition *functionDefinition = FunctionDefinition::definition(declaration);
+    if (functionDefinition)
+        functionInfo.definition = IndexedDeclaration(functionDefinition);
+
+    IProject *project = ICore::self()->projectController()->findProjectForUrl(declaration->url().toUrl());
+    if (project)
+        functionInfo.projectName = project->name();
 
-    if (calledFunctionContext && (m_currentLevel < m_maxLevel || m_maxLevel == 0))
+    if (m_cache)
     {
-        // For prevent endless loop in recursive methods
-        if (!m_visitedFunctions.contains(ideclaration))
-        {
-            ++m_currentLevel;
-            m_visitedFunctions.insert(ideclaration);
-            // Recursive call for method invocation
-            useDeclarationsFromDefinition(calledFunctionDefinition, calledFunctionDefinition->topContext(), calledFunctionContext);
-        }
+        // Labels depend on every file the projections were taken from
+        QList<IndexedString> files;
+        files << declaration->url();
+        for (int mode = ControlFlowFunction; mode <= ControlFlowNamespace; ++mode)
+            files << IndexedString(functionInfo.projections[mode].url);
+        m_cache->insertFunctionInfo(ideclaration, functionInfo, files);
     }
+
+    m_retainedGraphMutex.lock();
+    graph.functionInfos.insert(ideclaration, functionInfo);
+    m_retainedGraphMutex.unlock();
+}
+
+uint DUChainControlFlow::nodeId(const FunctionInfo &functionInfo, const QStringList &containers, const QString &label, uint usesOf)
+{
+    const DeclarationInfo &nodeInfo = functionInfo.projections[m_controlFlowMode];
+    uint nextId = m_declarationNodeIds.size() + m_namedNodeIds.size() + 1;
+
+    // In namespace mode, free functions collapse into a global namespace or folder node known by name only
+    if (m_controlFlowMode == ControlFlowNamespace && nodeInfo.hasInternalContext && nodeInfo.internalContextType != DUContext::Namespace)
+    {
+        QString name = containers.join("") + label;
+        if (!m_namedNodeIds.contains(name))
+            m_namedNodeIds.insert(name, nextId);
+        return m_namedNodeIds[name];
+    }
+
+    QPair<IndexedDeclaration, uint> key(nodeInfo.identity, usesOf);
+    if (!m_declarationNodeIds.contains(key))
+        m_declarationNodeIds.insert(key, nextId);
+    return m_declarationNodeIds[key];
 }
 
 void DUChainControlFlow::updateToolTip(const QString &edge, const QPoint& point, QWidget *partWidget)
 {
+    // Aggregated edges show the uses of every arc they stand for
+    QStringList sources, targets;
+    QList<QPair<RangeInRevision, IndexedString> > uses;
+    m_drawnGraphMutex.lock();
+    foreach (const QString &arc, m_dotControlFlowGraph->edgeMembers(edge))
+    {
+        QStringList labels = m_arcLabels.value(arc).split("->");
+        if (labels.size() < 2)
+            continue;
+        if (!sources.contains(labels[0]))
+            sources << labels[0];
+        if (!targets.contains(labels[1]))
+            targets << labels[1];
+        typedef QPair<RangeInRevision, IndexedString> ArcUse;
+        foreach (const ArcUse &use, m_arcUsesMap.values(arc))
+            if (!uses.contains(use))
+                uses << use;
+    }
+    m_drawnGraphMutex.unlock();
+
     ControlFlowGraphNavigationWidget *navigationWidget =
-                new ControlFlowGraphNavigationWidget(edge, m_arcUsesMap.values(edge));
+                new ControlFlowGraphNavigationWidget(sources.join(", ") + "->" + targets.join(", "), uses);
 
     KDevelop::NavigationToolTip *usesToolTip = new KDevelop::NavigationToolTip(
                                   partWidget,
@@ -363,9 +743,30 @@ void DUChainControlFlow::slotGraphElementSelected(QList<QString> list, const QPo
     if (!list.isEmpty())
     {
         QString label = list[0];
-        Declaration *declaration = m_identifierDeclarationMap[label].data();
+
+        // Clusters and summary nodes belong to the graph the running job is still building, only navigation is served meanwhile
+        if (!m_graphThreadRunning)
+        {
+            // Cluster or collapsed cluster click, toggle it using the graph already built
+            if (m_dotControlFlowGraph->toggleCluster(label))
+                return;
+
+            // Summary node click, expand all callees of the truncated functions
+            if (label.startsWith('+') && m_summaryNodes.contains(label.mid(1).toUInt()))
+            {
+                foreach (const IndexedDeclaration &function, m_summaryNodes[label.mid(1).toUInt()])
+                    m_expandedFunctions.insert(function);
+                refreshGraph();
+                return;
+            }
+        }
+
+        m_drawnGraphMutex.lock();
+        IndexedDeclaration ideclaration = m_identifierDeclarationMap.value(label.toUInt());
+        m_drawnGraphMutex.unlock();
 
         DUChainReadLocker lock(DUChain::lock());
+        Declaration *declaration = ideclaration.data();
 
         if (declaration) // Node click, jump to definition/declaration
         {
@@ -417,11 +818,57 @@ void DUChainControlFlow::setMaxLevel(int maxLevel)
     m_maxLevel = maxLevel;
 }
 
+void DUChainControlFlow::setMaxNodes(int maxNodes)
+{
+    m_maxNodes = maxNodes;
+}
+
+void DUChainControlFlow::setMaxEdges(int maxEdges)
+{
+    m_maxEdges = maxEdges;
+}
+
+void DUChainControlFlow::setLevelBudget(int levelBudget)
+{
+    m_levelBudget = levelBudget;
+}
+
 void DUChainControlFlow::setShowUsesOnEdgeHover(bool checked)
 {
     m_ShowUsesOnEdgeHover = checked;
 }
 
+void DUChainControlFlow::setCache(ControlFlowGraphCache *cache)
+{
+    m_cache = cache;
+}
+
+void DUChainControlFlow::setClassHierarchy(ControlFlowGraphClassHierarchy *classHierarchy)
+{
+    m_classHierarchy = classHierarchy;
+}
+
+void DUChainControlFlow::setExpandOverrides(bool expandOverrides)
+{
+    m_expandOverrides = expandOverrides;
+}
+
+void DUChainControlFlow::setCallFilter(const ControlFlowGraphCallFilter &callFilter)
+{
+    QMutexLocker locker(&m_callFilterMutex);
+    m_callFilter = callFilter;
+}
+
+void DUChainControlFlow::redrawGraph()
+{
+    m_redrawPending = false;
+    if (!m_graphThreadRunning)
+    {
+        drawGraph();
+        m_dotControlFlowGraph->graphDone();
+    }
+}
+
 void DUChainControlFlow::refreshGraph()
 {
     if (!m_locked)
@@ -442,9 +889,25 @@ void DUChainControlFlow::refreshGraph()
 
 void DUChainControlFlow::newGraph()
 {
-    m_visitedFunctions.clear();
+    m_graph.visitedFunctions.clear();
+    m_drawnGraphMutex.lock();
     m_identifierDeclarationMap.clear();
     m_arcUsesMap.clear();
+    m_arcLabels.clear();
+    m_declarationNodeIds.clear();
+    m_namedNodeIds.clear();
+    m_summaryNodes.clear();
+    m_drawnGraphMutex.unlock();
+    m_graph.rootFunctions.clear();
+    m_retainedGraphMutex.lock();
+    m_graph.functionCalls.clear();
+    m_graph.functionInfos.clear();
+    m_retainedGraphMutex.unlock();
+    m_drawnFunctionCalls = 0;
+    m_graph.hiddenCallees.clear();
+    m_graph.graphNodes.clear();
+    m_edgeCount = 0;
+    m_nodeCount = 0;
     m_currentProject = 0;
     m_dotControlFlowGraph->clearGraph();
 }
@@ -453,10 +916,419 @@ void DUChainControlFlow::jobDone (KJob* job)
 {
     m_graphThreadRunning = false;
     job->deleteLater();
+
+    // The cursor left the function while its graph was being built, the aborted graph is not worth drawing
+    if (m_restartPending)
+    {
+        m_restartPending = false;
+        emit jobDone();
+        refreshGraph();
+        return;
+    }
+
+    // Incoming arcs delivered to the main thread while the job was running
+    if (m_graph.functionCalls.size() != m_drawnFunctionCalls)
+        redrawGraph();
+
     emit jobDone();
 }
 
-void DUChainControlFlow::useDeclarationsFromDefinition (Declaration *definition, TopDUContext *topContext, DUContext *context)
+void DUChainControlFlow::calleesFromDefinition(Declaration *definition, DUContext *context, FunctionCalls &calls)
+{
+    IndexedDeclaration idefinition(definition);
+    ControlFlowGraphCache::Callees callees;
+    if (m_cache && m_cache->callees(idefinition, callees))
+    {
+        foreach (const ControlFlowGraphCache::Callees::value_type &callee, callees)
+            if (Declaration *target = callee.first.data())
+                calls << qMakePair(target, callee.second);
+    }
+    else
+    {
+        useDeclarationsFromDefinition(definition, context->topContext(), context, calls);
+        if (m_cache && !m_abort)
+        {
+            // Callee declarations go stale when their own files are reparsed, too
+            QList<IndexedString> files;
+            files << definition->url();
+            foreach (const FunctionCalls::value_type &call, calls)
+            {
+                callees << qMakePair(IndexedDeclaration(call.first), call.second);
+                if (!files.contains(call.first->url()))
+                    files << call.first->url();
+            }
+            m_cache->insertCallees(idefinition, callees, files);
+        }
+    }
+
+    // Virtual calls also reach every known override, at the same call site
+    if (m_expandOverrides && m_classHierarchy)
+    {
+        FunctionCalls overrideCalls;
+        QHash<Declaration *, QList<Declaration *> > overrides;
+        foreach (const FunctionCalls::value_type &call, calls)
+        {
+            if (!overrides.contains(call.first))
+                overrides.insert(call.first, m_classHierarchy->overrides(call.first));
+            foreach (Declaration *override, overrides[call.first])
+                overrideCalls << qMakePair(override, call.second);
+        }
+        calls << overrideCalls;
+    }
+
+    // Filtering after the cache keeps cached callees valid for every filter
+    QHash<Declaration *, ControlFlowGraphCallFilter::Action> actions;
+    for (FunctionCalls::iterator call = calls.begin(); call != calls.end(); )
+    {
+        if (!actions.contains(call->first))
+            actions.insert(call->first, callFilterAction(call->first));
+        if (actions[call->first] == ControlFlowGraphCallFilter::Hide)
+            call = calls.erase(call);
+        else
+            ++call;
+    }
+}
+
+ControlFlowGraphCallFilter::Action DUChainControlFlow::callFilterAction(Declaration *function)
+{
+    QMutexLocker locker(&m_callFilterMutex);
+    return m_callFilter.action(function);
+}
+
+void DUChainControlFlow::expandFunction(CallGraph &graph, Declaration *definition, DUContext *context, int level, QList<PendingFunction> &nextLevel)
+{
+    FunctionCalls calls;
+    IndexedDeclaration idefinition(definition);
+    calleesFromDefinition(definition, context, calls);
+
+    // Group call sites by called function, keeping the order of first appearance
+    QList<Declaration *> targets;
+    QHash<Declaration *, QList<Use> > targetUses;
+    foreach (const FunctionCalls::value_type &call, calls)
+    {
+        if (!targetUses.contains(call.first))
+            targets << call.first;
+        targetUses[call.first] << call.second;
+    }
+    std::stable_sort(targets.begin(), targets.end(),
+                     [&targetUses](Declaration *a, Declaration *b) { return targetUses[a].size() > targetUses[b].size(); });
+
+    bool expandAll = m_expandedFunctions.contains(idefinition);
+    int hiddenCallees = 0;
+
+    foreach (Declaration *target, targets)
+    {
+        if (m_abort)
+            return;
+
+        IndexedDeclaration itarget(target);
+        if (!expandAll && !isWithinBudget(graph, itarget))
+        {
+            ++hiddenCallees;
+            continue;
+        }
+
+        const QList<Use> &uses = targetUses[target];
+        foreach (const Use &use, uses)
+            processFunctionCall(graph, definition, target, use);
+        insertGraphNode(graph, itarget);
+        m_edgeCount.fetchAndAddRelaxed(uses.size());
+
+        // Excluded functions are kept as leaves
+        if (callFilterAction(target) != ControlFlowGraphCallFilter::Expand)
+            continue;
+
+        FunctionDefinition *calledFunctionDefinition = FunctionDefinition::definition(target);
+        if (!calledFunctionDefinition || !calledFunctionDefinition->internalContext())
+            continue;
+
+        IndexedDeclaration icalledFunctionDefinition(calledFunctionDefinition);
+        // For prevent endless loop in recursive methods
+        if ((level + 1 < m_maxLevel || m_maxLevel == 0) && !graph.visitedFunctions.contains(icalledFunctionDefinition))
+        {
+            graph.visitedFunctions.insert(icalledFunctionDefinition);
+            nextLevel << PendingFunction(icalledFunctionDefinition, IndexedDUContext(calledFunctionDefinition->internalContext()), uses.size());
+        }
+    }
+
+    if (hiddenCallees > 0)
+    {
+        retainFunctionInfo(graph, definition);
+        graph.hiddenCallees[idefinition] += hiddenCallees;
+    }
+}
+
+void DUChainControlFlow::yieldLock(DUChainReadLocker &lock, QElapsedTimer &lockTimer)
+{
+    // Writers only get the lock once no reader holds it, so long traversals step aside regularly
+    if (!lockTimer.hasExpired(lockSlice))
+        return;
+
+    lock.unlock();
+    QThread::msleep(1);
+    lock.lock();
+    lockTimer.start();
+}
+
+void DUChainControlFlow::insertGraphNode(CallGraph &graph, const IndexedDeclaration &function)
+{
+    // Functions reached from several roots are counted once per root, which only makes the shared budget stricter
+    if (graph.graphNodes.contains(function))
+        return;
+    graph.graphNodes.insert(function);
+    m_nodeCount.ref();
+}
+
+bool DUChainControlFlow::isWithinBudget(const CallGraph &graph, const IndexedDeclaration &function) const
+{
+    if (m_maxEdges != 0 && m_edgeCount.load() >= m_maxEdges)
+        return false;
+
+    return m_maxNodes == 0 || m_nodeCount.load() < m_maxNodes || graph.graphNodes.contains(function);
+}
+
+IndexedDeclaration DUChainControlFlow::functionIdentity(Declaration *function)
+{
+    // Calls refer to declarations, so definitions are represented by their declaration
+    if (function->isDefinition())
+    {
+        Declaration *declaration = DUChainUtils::declarationForDefinition(function, function->topContext());
+        if (declaration)
+            function = declaration;
+    }
+    return IndexedDeclaration(function);
+}
+
+QList<DUChainControlFlow::FunctionCall> DUChainControlFlow::calleesOf(const IndexedDeclaration &function)
+{
+    QList<FunctionCall> functionCalls;
+    Declaration *declaration = function.data();
+    if (!declaration)
+        return functionCalls;
+
+    Declaration *definition = declaration->isDefinition() ? declaration : FunctionDefinition::definition(declaration);
+    if (!definition || !definition->internalContext())
+        return functionCalls;
+
+    FunctionCalls calls;
+    calleesFromDefinition(definition, definition->internalContext(), calls);
+    foreach (const FunctionCalls::value_type &call, calls)
+    {
+        FunctionCall functionCall;
+        functionCall.source = function;
+        functionCall.target = functionIdentity(call.first);
+        functionCall.range = call.second.m_range;
+        functionCall.url = definition->url();
+        functionCall.incoming = false;
+        functionCalls << functionCall;
+    }
+    return functionCalls;
+}
+
+QList<IndexedDeclaration> DUChainControlFlow::calledFunctions(const IndexedDeclaration &function)
+{
+    QList<IndexedDeclaration> functions;
+    foreach (const FunctionCall &functionCall, calleesOf(function))
+        if (functionCall.target.isValid() && !functions.contains(functionCall.target))
+            functions << functionCall.target;
+    return functions;
+}
+
+QList<DUChainControlFlow::FunctionCall> DUChainControlFlow::callersOf(const IndexedDeclaration &function)
+{
+    QList<FunctionCall> functionCalls;
+    Declaration *declaration = function.data();
+    if (!declaration)
+        return functionCalls;
+
+    QMap<IndexedString, QList<RangeInRevision> > uses = declaration->uses();
+    QMap<IndexedString, QList<RangeInRevision> >::const_iterator usesIterator = uses.constBegin();
+    for (; usesIterator != uses.constEnd(); ++usesIterator)
+    {
+        TopDUContext *topContext = DUChainUtils::standardContextForUrl(usesIterator.key().toUrl());
+        if (!topContext)
+            continue;
+
+        foreach (const RangeInRevision &range, usesIterator.value())
+        {
+            // The caller is the function owning the uppermost executable context around the use
+            DUContext *context = topContext->findContextAt(range.start);
+            if (!context || context->type() != DUContext::Other)
+                continue;
+            while (context->parentContext() && context->parentContext()->type() == DUContext::Other)
+                context = context->parentContext();
+            if (!context->owner())
+                continue;
+
+            FunctionCall functionCall;
+            functionCall.source = functionIdentity(context->owner());
+            functionCall.target = function;
+            functionCall.range = range;
+            functionCall.url = usesIterator.key();
+            functionCall.incoming = false;
+            functionCalls << functionCall;
+        }
+    }
+    return functionCalls;
+}
+
+QList<DUChainControlFlow::CallPath> DUChainControlFlow::callPaths(const IndexedDeclaration &source, const IndexedDeclaration &target, int maxPaths)
+{
+    return searchCallPaths(source, target, maxPaths, 0);
+}
+
+QList<DUChainControlFlow::CallPath> DUChainControlFlow::searchCallPaths(const IndexedDeclaration &source, const IndexedDeclaration &target, int maxPaths,
+                                                                       QHash<CallEdge, FunctionCall> *edges)
+{
+    QList<CallPath> paths;
+    if (!source.data() || !target.data() || maxPaths <= 0)
+        return paths;
+
+    // Search forward over callees from the source and backward over callers from the target,
+    // always advancing the smaller frontier by one level, until both searches meet
+    QHash<IndexedDeclaration, int> sourceDistances, targetDistances;
+    QMultiHash<IndexedDeclaration, IndexedDeclaration> sourceParents, targetParents;
+    QList<IndexedDeclaration> sourceFrontier, targetFrontier, meetings;
+    QSet<IndexedDeclaration> meetingSet;
+    sourceDistances[source] = 0;
+    targetDistances[target] = 0;
+    sourceFrontier << source;
+    targetFrontier << target;
+    int sourceDepth = 0, targetDepth = 0, shortest = -1;
+    if (source == target)
+    {
+        meetings << source;
+        meetingSet << source;
+        shortest = 0;
+    }
+
+    // Once the shortest length is known, slightly longer levels still provide alternative paths
+    const int extraLength = 2;
+    const int maxVisited = 20000;
+    while (!m_abort && (!sourceFrontier.isEmpty() || !targetFrontier.isEmpty()) &&
+           (shortest < 0 || sourceDepth + targetDepth < shortest + extraLength) &&
+           sourceDistances.size() + targetDistances.size() < maxVisited)
+    {
+        bool forward = targetFrontier.isEmpty() || (!sourceFrontier.isEmpty() && sourceFrontier.size() <= targetFrontier.size());
+        QList<IndexedDeclaration> &frontier = forward ? sourceFrontier : targetFrontier;
+        QHash<IndexedDeclaration, int> &distances = forward ? sourceDistances : targetDistances;
+        const QHash<IndexedDeclaration, int> &otherDistances = forward ? targetDistances : sourceDistances;
+        QMultiHash<IndexedDeclaration, IndexedDeclaration> &parents = forward ? sourceParents : targetParents;
+
+        QList<IndexedDeclaration> nextFrontier;
+        foreach (const IndexedDeclaration &function, frontier)
+        {
+            if (m_abort)
+                break;
+
+            foreach (const FunctionCall &functionCall, forward ? calleesOf(function) : callersOf(function))
+            {
+                IndexedDeclaration neighbour = forward ? functionCall.target : functionCall.source;
+                if (!neighbour.isValid())
+                    continue;
+
+                CallEdge edge(functionCall.source, functionCall.target);
+                if (edges && !edges->contains(edge))
+                    edges->insert(edge, functionCall);
+
+                if (!distances.contains(neighbour))
+                {
+                    distances[neighbour] = distances[function] + 1;
+                    nextFrontier << neighbour;
+                }
+                // Parents only link consecutive levels, so the paths found are as short as possible
+                if (distances[neighbour] == distances[function] + 1 && !parents.contains(neighbour, function))
+                    parents.insert(neighbour, function);
+
+                if (otherDistances.contains(neighbour) && !meetingSet.contains(neighbour))
+                {
+                    meetings << neighbour;
+                    meetingSet << neighbour;
+                    int length = sourceDistances[neighbour] + targetDistances[neighbour];
+                    if (shortest < 0 || length < shortest)
+                        shortest = length;
+                }
+            }
+        }
+        frontier = nextFrontier;
+        ++(forward ? sourceDepth : targetDepth);
+    }
+
+    // Each path joins a source half and a target half at a meeting function, closest meetings first
+    std::stable_sort(meetings.begin(), meetings.end(), [&sourceDistances, &targetDistances](const IndexedDeclaration &a, const IndexedDeclaration &b)
+                     { return sourceDistances[a] + targetDistances[a] < sourceDistances[b] + targetDistances[b]; });
+    foreach (const IndexedDeclaration &meeting, meetings)
+    {
+        CallPath half;
+        QList<CallPath> sourceHalves, targetHalves;
+        pathsThrough(meeting, sourceParents, half, sourceHalves, maxPaths);
+        pathsThrough(meeting, targetParents, half, targetHalves, maxPaths);
+
+        foreach (const CallPath &sourceHalf, sourceHalves)
+            foreach (const CallPath &targetHalf, targetHalves)
+            {
+                CallPath path;
+                for (int i = sourceHalf.size() - 1; i >= 0; --i)
+                    path << sourceHalf[i];
+                path << targetHalf.mid(1);
+
+                // Halves may share functions when the graph has cycles
+                if (path.toSet().size() != path.size() || paths.contains(path))
+                    continue;
+                paths << path;
+                if (paths.size() >= maxPaths)
+                    return paths;
+            }
+    }
+    return paths;
+}
+
+void DUChainControlFlow::pathsThrough(const IndexedDeclaration &function, const QMultiHash<IndexedDeclaration, IndexedDeclaration> &parents,
+                                      CallPath &path, QList<CallPath> &paths, int maxPaths)
+{
+    path << function;
+    QList<IndexedDeclaration> functionParents = parents.values(function);
+    if (functionParents.isEmpty())
+        paths << path;
+    foreach (const IndexedDeclaration &parent, functionParents)
+    {
+        if (paths.size() >= maxPaths)
+            break;
+        pathsThrough(parent, parents, path, paths, maxPaths);
+    }
+    path.removeLast();
+}
+
+void DUChainControlFlow::findCallPaths(const IndexedDeclaration &target, int maxPaths)
+{
+    if (m_graphThreadRunning)
+    {
+        qDebug() << "Control flow thread already running";
+        return;
+    }
+
+    DUChainReadLocker lock(DUChain::lock());
+    Declaration *source = m_definition.data();
+    Declaration *targetDeclaration = target.data();
+    if (!source || !targetDeclaration)
+        return;
+
+    newGraph();
+    m_dotControlFlowGraph->prepareNewGraph();
+
+    m_callPathSource = functionIdentity(source);
+    m_callPathTarget = functionIdentity(targetDeclaration);
+    m_maxCallPaths = maxPaths;
+
+    m_graphThreadRunning = true;
+    DUChainControlFlowJob *job = new DUChainControlFlowJob(targetDeclaration->qualifiedIdentifier().toString(), this);
+    job->setControlFlowJobType(DUChainControlFlowInternalJob::ControlFlowJobCallPaths);
+    connect (job, SIGNAL(result(KJob*)), SLOT(jobDone(KJob*)));
+    emit startingJob();
+    ICore::self()->runController()->registerJob(job);
+}
+
+void DUChainControlFlow::useDeclarationsFromDefinition (Declaration *definition, TopDUContext *topContext, DUContext *context, FunctionCalls &calls)
 {
     if (!topContext) return;
 
@@ -478,41 +1350,41 @@ void DUChainControlFlow::useDeclarationsFromDefinition (Declaration *definition,
             if (subContextsIterator != subContextsEnd)
             {
                 if (uses[i].m_range.start < (*subContextsIterator)->range().start)
-                    processFunctionCall(definition, declaration, uses[i]);
+                    calls << qMakePair(declaration, uses[i]);
                 else if ((*subContextsIterator)->type() == DUContext::Other)
                 {
                     // Recursive call for sub-contexts
-                    useDeclarationsFromDefinition(definition, topContext, *subContextsIterator);
+                    useDeclarationsFromDefinition(definition, topContext, *subContextsIterator, calls);
                     ++subContextsIterator;
                     --i;
                 }
             }
             else
-                processFunctionCall(definition, declaration, uses[i]);
+                calls << qMakePair(declaration, uses[i]);
         }
     }
     while (subContextsIterator != subContextsEnd)
         if ((*subContextsIterator)->type() == DUContext::Other)
         {
             // Recursive call for remaining sub-contexts
-            useDeclarationsFromDefinition(definition, topContext, *subContextsIterator);
+            useDeclarationsFromDefinition(definition, topContext, *subContextsIterator, calls);
             ++subContextsIterator;
         }
 }
 
-Declaration *DUChainControlFlow::declarationFromControlFlowMode(Declaration *definitionDeclaration)
+Declaration *DUChainControlFlow::declarationFromControlFlowMode(Declaration *definitionDeclaration, ControlFlowMode controlFlowMode)
 {
     Declaration *nodeDeclaration = definitionDeclaration;
 
-    if (m_controlFlowMode != ControlFlowFunction)
+    if (controlFlowMode != ControlFlowFunction)
     {
         if (nodeDeclaration->isDefinition())
             nodeDeclaration = DUChainUtils::declarationForDefinition(nodeDeclaration, nodeDeclaration->topContext());
         if (!nodeDeclaration || !nodeDeclaration->context() || !nodeDeclaration->context()->owner()) return definitionDeclaration;
         while (nodeDeclaration->context() &&
                nodeDeclaration->context()->owner() &&
-               ((m_controlFlowMode == ControlFlowClass && nodeDeclaration->context() && nodeDeclaration->context()->type() == DUContext::Class) ||
-                (m_controlFlowMode == ControlFlowNamespace && (
+               ((controlFlowMode == ControlFlowClass && nodeDeclaration->context() && nodeDeclaration->context()->type() == DUContext::Class) ||
+                (controlFlowMode == ControlFlowNamespace && (
                                                               (nodeDeclaration->context() && nodeDeclaration->context()->type() == DUContext::Class) ||
                                                               (nodeDeclaration->context() && nodeDeclaration->context()->type() == DUContext::Namespace))
               )))
@@ -521,24 +1393,22 @@ Declaration *DUChainControlFlow::declarationFromControlFlowMode(Declaration *def
     return nodeDeclaration;
 }
 
-void DUChainControlFlow::prepareContainers(QStringList &containers, Declaration* definition)
+void DUChainControlFlow::prepareContainers(QStringList &containers, const FunctionInfo &functionInfo)
 {
-    ControlFlowMode originalControlFlowMode = m_controlFlowMode;
     QString strGlobalNamespaceOrFolderNames;
 
     // Handling project clustering
-    if (m_clusteringModes.testFlag(ClusteringProject) && ICore::self()->projectController()->findProjectForUrl(definition->url().str()))
-        containers << ICore::self()->projectController()->findProjectForUrl(definition->url().str())->name();
+    if (m_clusteringModes.testFlag(ClusteringProject) && !functionInfo.projectName.isEmpty())
+        containers << functionInfo.projectName;
 
     // Handling namespace clustering
     if (m_clusteringModes.testFlag(ClusteringNamespace))
     {
-        m_controlFlowMode = ControlFlowNamespace;
-        Declaration *namespaceDefinition = declarationFromControlFlowMode(definition);
+        const DeclarationInfo &namespaceInfo = functionInfo.projections[ControlFlowNamespace];
 
-        strGlobalNamespaceOrFolderNames = ((namespaceDefinition->internalContext() && namespaceDefinition->internalContext()->type() != DUContext::Namespace) ?
-                                                              globalNamespaceOrFolderNames(namespaceDefinition):
-                                                              shortNameFromContainers(containers, prependFolderNames(namespaceDefinition)));
+        strGlobalNamespaceOrFolderNames = ((namespaceInfo.hasInternalContext && namespaceInfo.internalContextType != DUContext::Namespace) ?
+                                                              globalNamespaceOrFolderNames(namespaceInfo):
+                                                              shortNameFromContainers(containers, prependFolderNames(functionInfo, ControlFlowNamespace)));
         foreach(const QString &container, strGlobalNamespaceOrFolderNames.split("::"))
             containers << container;
     }
@@ -546,23 +1416,20 @@ void DUChainControlFlow::prepareContainers(QStringList &containers, Declaration*
     // Handling class clustering
     if (m_clusteringModes.testFlag(ClusteringClass))
     {
-        m_controlFlowMode = ControlFlowClass;
-        Declaration *classDefinition = declarationFromControlFlowMode(definition);
+        const DeclarationInfo &classInfo = functionInfo.projections[ControlFlowClass];
 
-        if (classDefinition->internalContext() && classDefinition->internalContext()->type() == DUContext::Class)
-            containers << shortNameFromContainers(containers, prependFolderNames(classDefinition));
+        if (classInfo.hasInternalContext && classInfo.internalContextType == DUContext::Class)
+            containers << shortNameFromContainers(containers, prependFolderNames(functionInfo, ControlFlowClass));
     }
-
-    m_controlFlowMode = originalControlFlowMode;
 }
 
-QString DUChainControlFlow::globalNamespaceOrFolderNames(Declaration *declaration)
+QString DUChainControlFlow::globalNamespaceOrFolderNames(const DeclarationInfo &declarationInfo)
 {
     if (m_useFolderName && m_currentProject && m_includeDirectories.count() > 0)
     {
         int minLength = std::numeric_limits<int>::max();
 
-        QString folderName, smallestDirectory, declarationUrl = declaration->url().str();
+        QString folderName, smallestDirectory, declarationUrl = declarationInfo.url;
 
         foreach (const Path &url, m_includeDirectories)
         {
@@ -574,7 +1441,7 @@ QString DUChainControlFlow::globalNamespaceOrFolderNames(Declaration *declaratio
             }
         }
         declarationUrl = declarationUrl.remove(0, smallestDirectory.length());
-        declarationUrl = declarationUrl.remove(declaration->url().str());
+        declarationUrl = declarationUrl.remove(declarationInfo.url);
         if (declarationUrl.endsWith('/'))
             declarationUrl.chop(1);
         if (declarationUrl.startsWith('/'))
@@ -586,20 +1453,17 @@ QString DUChainControlFlow::globalNamespaceOrFolderNames(Declaration *declaratio
     return i18n("Global Namespace");
 }
 
-QString DUChainControlFlow::prependFolderNames(Declaration *declaration)
+QString DUChainControlFlow::prependFolderNames(const FunctionInfo &functionInfo, ControlFlowMode controlFlowMode)
 {
-    QString prependedQualifiedName = declaration->qualifiedIdentifier().toString();
+    QString prependedQualifiedName = functionInfo.projections[controlFlowMode].qualifiedIdentifier;
     if (m_useFolderName)
     {
-        ControlFlowMode originalControlFlowMode = m_controlFlowMode;
-        m_controlFlowMode = ControlFlowNamespace;
-        Declaration *namespaceDefinition = declarationFromControlFlowMode(declaration);
-        m_controlFlowMode = originalControlFlowMode;
+        const DeclarationInfo &namespaceInfo = functionInfo.projections[ControlFlowNamespace];
 
-        QString prefix = globalNamespaceOrFolderNames(namespaceDefinition);
+        QString prefix = globalNamespaceOrFolderNames(namespaceInfo);
 
-        if (namespaceDefinition && namespaceDefinition->internalContext() &&
-            namespaceDefinition->internalContext()->type() != DUContext::Namespace &&
+        if (namespaceInfo.hasInternalContext &&
+            namespaceInfo.internalContextType != DUContext::Namespace &&
             prefix != i18n("Global Namespace"))
             prependedQualifiedName.prepend(prefix + "::");
     }
@@ -607,6 +1471,17 @@ QString DUChainControlFlow::prependFolderNames(Declaration *declaration)
     return prependedQualifiedName;
 }
 
+QString DUChainControlFlow::labelFromControlFlowMode(const FunctionInfo &functionInfo, const QStringList &containers)
+{
+    const DeclarationInfo &nodeInfo = functionInfo.projections[m_controlFlowMode];
+
+    return shortNameFromContainers(containers,
+                                   (m_controlFlowMode == ControlFlowNamespace &&
+                                    (nodeInfo.hasInternalContext && nodeInfo.internalContextType != DUContext::Namespace)) ?
+                                                     globalNamespaceOrFolderNames(nodeInfo) :
+                                                     prependFolderNames(functionInfo, m_controlFlowMode));
+}
+
 QString DUChainControlFlow::shortNameFromContainers(const QList<QString> &containers, const QString &qualifiedIdentifier)
 {
     QString shortName = qualifiedIdentifier;
@@ -23,11 +23,18 @@
 #include <QSet>
 #include <QHash>
 #include <QPair>
+#include <QMutex>
 #include <QPointer>
+#include <QAtomicInt>
+#include <QElapsedTimer>
 
 #include <language/duchain/ducontext.h>
+#include <serialization/indexedstring.h>
 #include <util/path.h>
 
+#include "controlflowgraphusescollector.h"
+#include "controlflowgraphcallfilter.h"
+
 class QPoint;
 
 namespace KTextEditor {
@@ -41,12 +48,14 @@ namespace KDevelop {
     class Declaration;
     class TopDUContext;
     class IProject;
+    class DUChainReadLocker;
 }
 
 class KJob;
 
 class DotControlFlowGraph;
-class ControlFlowGraphUsesCollector;
+class ControlFlowGraphClassHierarchy;
+class ControlFlowGraphCache;
 
 using namespace KDevelop;
 
@@ -71,13 +80,49 @@ public:
     void setClusteringModes(ClusteringModes clusteringModes);
     ClusteringModes clusteringModes() const;
 
+    // Naming data of a function projected to a control flow mode, kept so that labels can be rebuilt without the DUChain
+    struct DeclarationInfo
+    {
+        DeclarationInfo() : hasInternalContext(false), internalContextType(DUContext::Other) { }
+
+        IndexedDeclaration declaration;
+        IndexedDeclaration identity;
+        QString qualifiedIdentifier;
+        QString url;
+        bool hasInternalContext;
+        DUContext::ContextType internalContextType;
+    };
+
+    struct FunctionInfo
+    {
+        DeclarationInfo projections[ControlFlowNamespace + 1];
+        IndexedDeclaration definition;
+        QString projectName;
+    };
+
     void generateControlFlowForDeclaration(IndexedDeclaration idefinition, IndexedTopDUContext itopContext, IndexedDUContext iuppermostExecutableContext);
+    // Traverses independent roots in parallel and merges their graphs, locks the DUChain by itself
+    void generateControlFlowForDeclarations(const QList<IndexedDeclaration> &definitions);
     bool isLocked();
     void run();
+    void runCallPaths();
+
+    // Up to maxPaths shortest call paths from source to target, the DUChain must be read locked
+    typedef QList<IndexedDeclaration> CallPath;
+    QList<CallPath> callPaths(const IndexedDeclaration &source, const IndexedDeclaration &target, int maxPaths);
+    // Replaces the graph with the call paths from the current function to target
+    void findCallPaths(const IndexedDeclaration &target, int maxPaths = 5);
+
+    // Functions are identified by their declaration, the DUChain must be read locked
+    static IndexedDeclaration functionIdentity(Declaration *function);
+    QList<IndexedDeclaration> calledFunctions(const IndexedDeclaration &function);
+    void drawGraph();
+    void requestAbort();
 
 public Q_SLOTS:
     void cursorPositionChanged(KTextEditor::View *view, const KTextEditor::Cursor &cursor);
     void processFunctionCall(Declaration *source, Declaration *target, const Use &use);
+    void processFunctionCalls(const KDevelop::IndexedString &url, const ControlFlowGraphUsesCollector::CallSites &callSites);
 
     void slotGraphElementSelected(const QList<QString> list, const QPoint& point);
     void slotEdgeHover(QString label);
@@ -87,8 +132,16 @@ public Q_SLOTS:
     void setUseShortNames(bool useFolderName);
     void setDrawIncomingArcs(bool drawIncomingArcs);
     void setMaxLevel(int maxLevel);
+    void setMaxNodes(int maxNodes);
+    void setMaxEdges(int maxEdges);
+    void setLevelBudget(int levelBudget);
     void setShowUsesOnEdgeHover(bool checked);
+    void setCache(ControlFlowGraphCache *cache);
+    void setClassHierarchy(ControlFlowGraphClassHierarchy *classHierarchy);
+    void setExpandOverrides(bool expandOverrides);
+    void setCallFilter(const ControlFlowGraphCallFilter &callFilter);
 
+    void redrawGraph();
     void refreshGraph();
     void newGraph();
 
@@ -100,12 +153,79 @@ Q_SIGNALS:
     void jobDone();
 
 private:
-    void useDeclarationsFromDefinition(Declaration *definition, TopDUContext *topContext, DUContext *context);
-    Declaration *declarationFromControlFlowMode(Declaration *definitionDeclaration);
-    void prepareContainers(QStringList &containers, Declaration* definition);
-    QString globalNamespaceOrFolderNames(Declaration *declaration);
-    QString prependFolderNames(Declaration *declaration);
+    struct PendingFunction
+    {
+        PendingFunction(IndexedDeclaration definition, IndexedDUContext context, int multiplicity)
+        : definition(definition), context(context), multiplicity(multiplicity) {}
+        IndexedDeclaration definition;
+        IndexedDUContext context;
+        int multiplicity;
+    };
+    typedef QList< QPair<Declaration *, Use> > FunctionCalls;
+
+    // A call site in the retained function-level graph
+    struct FunctionCall
+    {
+        IndexedDeclaration source;
+        IndexedDeclaration target;
+        RangeInRevision range;
+        IndexedString url;
+        bool incoming;
+    };
+
+    typedef QPair<IndexedDeclaration, IndexedDeclaration> CallEdge;
+
+    // Function-level graph built by a traversal: the retained graph, or that of a root traversed on a pool thread
+    struct CallGraph
+    {
+        QList<IndexedDeclaration> rootFunctions;
+        QSet<IndexedDeclaration> visitedFunctions;
+        QList<FunctionCall> functionCalls;
+        QHash<IndexedDeclaration, FunctionInfo> functionInfos;
+        // Functions counted against the graph budget
+        QSet<IndexedDeclaration> graphNodes;
+        // Number of callees left out of the graph, by calling function
+        QHash<IndexedDeclaration, int> hiddenCallees;
+    };
+
+    // A root traversed on a pool thread, with a visited set of its own
+    struct PartialRoot
+    {
+        PartialRoot(IndexedDeclaration definition = IndexedDeclaration()) : definition(definition) {}
+        IndexedDeclaration definition;
+        CallGraph graph;
+    };
+
+    bool restartJob();
+    void traverseRoot(CallGraph &graph, const IndexedDeclaration &idefinition, const IndexedDUContext &icontext,
+                      DUChainReadLocker &lock, int levelBudget);
+    void traversePartialRoot(PartialRoot &root);
+    void updateClassHierarchy();
+    void collectIncomingCalls(Declaration *definition, TopDUContext *topContext);
+
+    void calleesFromDefinition(Declaration *definition, DUContext *context, FunctionCalls &calls);
+    ControlFlowGraphCallFilter::Action callFilterAction(Declaration *function);
+    void expandFunction(CallGraph &graph, Declaration *definition, DUContext *context, int level, QList<PendingFunction> &nextLevel);
+    QList<FunctionCall> calleesOf(const IndexedDeclaration &function);
+    QList<FunctionCall> callersOf(const IndexedDeclaration &function);
+    QList<CallPath> searchCallPaths(const IndexedDeclaration &source, const IndexedDeclaration &target, int maxPaths,
+                                    QHash<CallEdge, FunctionCall> *edges);
+    void pathsThrough(const IndexedDeclaration &function, const QMultiHash<IndexedDeclaration, IndexedDeclaration> &parents,
+                      CallPath &path, QList<CallPath> &paths, int maxPaths);
+    void yieldLock(DUChainReadLocker &lock, QElapsedTimer &lockTimer);
+    void insertGraphNode(CallGraph &graph, const IndexedDeclaration &function);
+    bool isWithinBudget(const CallGraph &graph, const IndexedDeclaration &function) const;
+    void drawFunctionCall(const FunctionCall &functionCall, const FunctionInfo &sourceInfo, const FunctionInfo &targetInfo);
+    void processFunctionCall(CallGraph &graph, Declaration *source, Declaration *target, const Use &use);
+    void retainFunctionInfo(CallGraph &graph, Declaration *declaration);
+    uint nodeId(const FunctionInfo &functionInfo, const QStringList &containers, const QString &label, uint usesOf = 0);
+    void useDeclarationsFromDefinition(Declaration *definition, TopDUContext *topContext, DUContext *context, FunctionCalls &calls);
+    Declaration *declarationFromControlFlowMode(Declaration *definitionDeclaration, ControlFlowMode controlFlowMode);
+    void prepareContainers(QStringList &containers, const FunctionInfo &functionInfo);
+    QString globalNamespaceOrFolderNames(const DeclarationInfo &declarationInfo);
+    QString prependFolderNames(const FunctionInfo &functionInfo, ControlFlowMode controlFlowMode);
     QString shortNameFromContainers(const QList<QString> &containers, const QString &qualifiedIdentifier);
+    QString labelFromControlFlowMode(const FunctionInfo &functionInfo, const QStringList &containers);
     void updateToolTip(const QString &edge, const QPoint& point, QWidget *partWidget);
 
     QPointer<DotControlFlowGraph> m_dotControlFlowGraph;
@@ -118,15 +238,47 @@ private:
     IndexedTopDUContext m_topContext;
     IndexedDUContext m_uppermostExecutableContext;
     
-    QSet<IndexedDeclaration> m_visitedFunctions;
-    QHash<QString, IndexedDeclaration> m_identifierDeclarationMap;
+    CallGraph m_graph;
+    QMutex m_retainedGraphMutex;
+    // Guards the lookups of the drawn graph, which the view reads while the job draws
+    QMutex m_drawnGraphMutex;
+    int m_drawnFunctionCalls;
+    bool m_redrawPending;
+    QHash<uint, IndexedDeclaration> m_identifierDeclarationMap;
     QMultiHash<QString, QPair<RangeInRevision, IndexedString> > m_arcUsesMap;
+    // "source->target" labels of each arc, which is keyed by node IDs
+    QHash<QString, QString> m_arcLabels;
+    // Graph nodes are interned to dense IDs, by declaration (and "Uses of" cluster) or by name for folder nodes
+    QHash<QPair<IndexedDeclaration, uint>, uint> m_declarationNodeIds;
+    QHash<QString, uint> m_namedNodeIds;
     QPointer<KDevelop::IProject> m_currentProject;
-    
-    int  m_currentLevel;
+
+    // Graph budget, shared by all the roots traversed in parallel
+    QAtomicInt m_edgeCount;
+    QAtomicInt m_nodeCount;
+    QHash<uint, QList<IndexedDeclaration> > m_summaryNodes;
+
+    // Endpoints of the call path query run by runCallPaths
+    IndexedDeclaration m_callPathSource;
+    IndexedDeclaration m_callPathTarget;
+    int m_maxCallPaths;
+    QSet<IndexedDeclaration> m_expandedFunctions;
+
+    // Callee lists and label data shared with the other views and exports
+    ControlFlowGraphCache *m_cache;
+    ControlFlowGraphClassHierarchy *m_classHierarchy;
+    // Excluded functions are pruned while traversing, incoming calls are filtered from another thread
+    ControlFlowGraphCallFilter m_callFilter;
+    QMutex m_callFilterMutex;
+
     int  m_maxLevel;
+    int  m_maxNodes;
+    int  m_maxEdges;
+    // Milliseconds during which the graph is shown and deepened level by level, 0 draws it once at the end
+    int  m_levelBudget;
     bool m_locked;
     bool m_drawIncomingArcs;
+    bool m_expandOverrides;
     bool m_useFolderName;
     bool m_useShortNames;
     bool m_ShowUsesOnEdgeHover;
@@ -135,6 +287,7 @@ private:
     ClusteringModes m_clusteringModes;
     
     bool m_graphThreadRunning;
+    bool m_restartPending;
     bool m_abort;
     
     QPointer<ControlFlowGraphUsesCollector> m_collector;
@@ -45,6 +45,8 @@ void DUChainControlFlowInternalJob::requestAbort()
         qDebug() << "Requesting abort";
         m_plugin->requestAbort();
     }
+    else if (m_duchainControlFlow)
+        m_duchainControlFlow->requestAbort();
 }
 
 void DUChainControlFlowInternalJob::run(ThreadWeaver::JobPointer /*self*/, ThreadWeaver::Thread */*thread*/)
@@ -58,6 +60,12 @@ void DUChainControlFlowInternalJob::run(ThreadWeaver::JobPointer /*self*/, Threa
                 m_duchainControlFlow->run();
             break;
         }
+        case ControlFlowJobCallPaths:
+        {
+            if (m_duchainControlFlow)
+                m_duchainControlFlow->runCallPaths();
+            break;
+        }
         case ControlFlowJobBatchForFunction:
         {
             if (m_plugin)
@@ -76,6 +84,18 @@ void DUChainControlFlowInternalJob::run(ThreadWeaver::JobPointer /*self*/, Threa
                 m_plugin->generateProjectControlFlowGraph();
             break;
         }
+        case ControlFlowJobBatchForProjectClasses:
+        {
+            if (m_plugin)
+                m_plugin->generateProjectClassesControlFlowGraphs();
+            break;
+        }
+        case ControlFlowJobProjectAnalysis:
+        {
+            if (m_plugin)
+                m_plugin->analyzeProject();
+            break;
+        }
     };
     emit done();
 }
@@ -34,7 +34,7 @@ public:
     DUChainControlFlowInternalJob(DUChainControlFlow *duchainControlFlow, KDevControlFlowGraphViewPlugin *plugin);
     virtual ~DUChainControlFlowInternalJob();
     
-    enum ControlFlowJobType { ControlFlowJobInteractive, ControlFlowJobBatchForFunction, ControlFlowJobBatchForClass, ControlFlowJobBatchForProject };
+    enum ControlFlowJobType { ControlFlowJobInteractive, ControlFlowJobBatchForFunction, ControlFlowJobBatchForClass, ControlFlowJobBatchForProject, ControlFlowJobBatchForProjectClasses, ControlFlowJobCallPaths, ControlFlowJobProjectAnalysis };
     void setControlFlowJobType (ControlFlowJobType controlFlowJobType);
 
     virtual void requestAbort();
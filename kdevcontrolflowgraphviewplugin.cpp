@@ -20,6 +20,8 @@
 #include "kdevcontrolflowgraphviewplugin.h"
 
 #include <QAction>
+#include <QInputDialog>
+#include <QSet>
 
 #include <KAboutData>
 #include <KMessageBox>
@@ -36,7 +38,9 @@
 #include <interfaces/idocumentcontroller.h>
 #include <interfaces/contextmenuextension.h>
 
+#include <language/duchain/duchain.h>
 #include <language/duchain/codemodel.h>
+#include <language/duchain/duchainlock.h>
 #include <language/duchain/declaration.h>
 #include <language/duchain/classdeclaration.h>
 #include <language/duchain/types/functiontype.h>
@@ -58,6 +62,11 @@
 #include "dotcontrolflowgraph.h"
 #include "controlflowgraphview.h"
 #include "duchaincontrolflowjob.h"
+#include "controlflowgraphlinecache.h"
+#include "controlflowgraphcache.h"
+#include "controlflowgraphclasshierarchy.h"
+#include "controlflowgraphreachability.h"
+#include "controlflowgraphmetrics.h"
 
 using namespace KDevelop;
 
@@ -88,6 +97,9 @@ KDevelop::IPlugin (QStringLiteral("kdevcontrolflowgraphview"), parent),
 m_toolViewFactory(new KDevControlFlowGraphViewFactory(this)),
 m_activeToolView(0),
 m_project(0),
+m_cache(new ControlFlowGraphCache),
+m_classHierarchy(new ControlFlowGraphClassHierarchy),
+m_projectAnalysis(0),
 m_abort(false)
 {
     core()->uiController()->addToolView(i18n("Control Flow Graph"), m_toolViewFactory);
@@ -109,10 +121,25 @@ m_abort(false)
 
     m_exportProjectControlFlowGraph = new QAction(i18n("Export Project Control Flow Graph"), this);
     connect(m_exportProjectControlFlowGraph, SIGNAL(triggered(bool)), SLOT(slotExportProjectControlFlowGraph(bool)), Qt::UniqueConnection);
+
+    m_exportProjectClassesControlFlowGraph = new QAction(i18n("Export Control Flow Graph for Every Class"), this);
+    connect(m_exportProjectClassesControlFlowGraph, SIGNAL(triggered(bool)), SLOT(slotExportProjectControlFlowGraph(bool)), Qt::UniqueConnection);
+
+    m_findCallPaths = new QAction(i18n("Find Call Paths"), this);
+    connect(m_findCallPaths, SIGNAL(triggered(bool)), SLOT(slotFindCallPaths(bool)), Qt::UniqueConnection);
+
+    m_findUnreachableFunctions = new QAction(i18n("Find Unreachable Functions"), this);
+    connect(m_findUnreachableFunctions, SIGNAL(triggered(bool)), SLOT(slotFindUnreachableFunctions(bool)), Qt::UniqueConnection);
+
+    m_computeCallMetrics = new QAction(i18n("Compute Call Metrics"), this);
+    connect(m_computeCallMetrics, SIGNAL(triggered(bool)), SLOT(slotComputeCallMetrics(bool)), Qt::UniqueConnection);
 }
 
 KDevControlFlowGraphViewPlugin::~KDevControlFlowGraphViewPlugin()
 {
+    delete m_cache;
+    delete m_classHierarchy;
+    DotControlFlowGraph::releaseContext();
 }
 
 QString KDevControlFlowGraphViewPlugin::statusName() const
@@ -126,6 +153,16 @@ void KDevControlFlowGraphViewPlugin::unload()
     core()->uiController()->removeToolView(m_toolViewFactory);
 }
 
+ControlFlowGraphCache *KDevControlFlowGraphViewPlugin::cache() const
+{
+    return m_cache;
+}
+
+ControlFlowGraphClassHierarchy *KDevControlFlowGraphViewPlugin::classHierarchy() const
+{
+    return m_classHierarchy;
+}
+
 void KDevControlFlowGraphViewPlugin::registerToolView(ControlFlowGraphView *view)
 {
     m_toolViews << view;
@@ -138,6 +175,12 @@ void KDevControlFlowGraphViewPlugin::unRegisterToolView(ControlFlowGraphView *vi
 
 QPointer<ControlFlowGraphFileDialog> KDevControlFlowGraphViewPlugin::exportControlFlowGraph(ControlFlowGraphFileDialog::OpeningMode mode)
 {
+    if (!DotControlFlowGraph::graphvizAvailable())
+    {
+        KMessageBox::error((QWidget *) ICore::self()->uiController()->activeMainWindow(), i18n("Could not export control flow graph - unable to load the Graphviz libraries"));
+        return 0;
+    }
+
     QPointer<ControlFlowGraphFileDialog> fileDialog = new ControlFlowGraphFileDialog((QWidget *) ICore::self()->uiController()->activeMainWindow(), mode);
     if (fileDialog->exec() == QDialog::Accepted)
     {
@@ -180,6 +223,13 @@ KDevControlFlowGraphViewPlugin::contextMenuExtension(KDevelop::Context* context)
             m_exportClassControlFlowGraph->setData(QVariant::fromValue(DUChainBasePointer(declaration)));
             extension.addAction(KDevelop::ContextMenuExtension::ExtensionGroup, m_exportClassControlFlowGraph);
         }
+        // Insert action for finding how the function shown in the tool view reaches this one
+        if (declaration && declaration->type<KDevelop::FunctionType>() && m_activeToolView)
+        {
+            m_findCallPaths->setText(i18n("Find Call Paths to %1", declaration->identifier().toString()));
+            m_findCallPaths->setData(QVariant::fromValue(DUChainBasePointer(declaration)));
+            extension.addAction(KDevelop::ContextMenuExtension::ExtensionGroup, m_findCallPaths);
+        }
     }
     else if (context->hasType(Context::ProjectItemContext))
     {
@@ -194,6 +244,12 @@ KDevControlFlowGraphViewPlugin::contextMenuExtension(KDevelop::Context* context)
                 {
                     m_exportProjectControlFlowGraph->setData(QVariant::fromValue(folder->project()->name()));
                     extension.addAction(KDevelop::ContextMenuExtension::ExtensionGroup, m_exportProjectControlFlowGraph);
+                    m_exportProjectClassesControlFlowGraph->setData(QVariant::fromValue(folder->project()->name()));
+                    extension.addAction(KDevelop::ContextMenuExtension::ExtensionGroup, m_exportProjectClassesControlFlowGraph);
+                    m_findUnreachableFunctions->setData(QVariant::fromValue(folder->project()->name()));
+                    extension.addAction(KDevelop::ContextMenuExtension::ExtensionGroup, m_findUnreachableFunctions);
+                    m_computeCallMetrics->setData(QVariant::fromValue(folder->project()->name()));
+                    extension.addAction(KDevelop::ContextMenuExtension::ExtensionGroup, m_computeCallMetrics);
                 }
             }
         }
@@ -203,7 +259,8 @@ KDevControlFlowGraphViewPlugin::contextMenuExtension(KDevelop::Context* context)
 
 void KDevControlFlowGraphViewPlugin::projectOpened(KDevelop::IProject* project)
 {
-    Q_UNUSED(project);
+    // Project names are part of the cached labels
+    m_cache->clear();
     foreach (ControlFlowGraphView *controlFlowGraphView, m_toolViews)
         controlFlowGraphView->setProjectButtonsEnabled(true);
     refreshActiveToolView();
@@ -211,7 +268,8 @@ void KDevControlFlowGraphViewPlugin::projectOpened(KDevelop::IProject* project)
 
 void KDevControlFlowGraphViewPlugin::projectClosed(KDevelop::IProject* project)
 {
-    Q_UNUSED(project);
+    m_cache->clear();
+    m_classHierarchy->removeProject(project);
     if (core()->projectController()->projectCount() == 0)
     {
         foreach (ControlFlowGraphView *controlFlowGraphView, m_toolViews)
@@ -225,6 +283,9 @@ void KDevControlFlowGraphViewPlugin::projectClosed(KDevelop::IProject* project)
 
 void KDevControlFlowGraphViewPlugin::parseJobFinished(KDevelop::ParseJob* parseJob)
 {
+    ControlFlowGraphLineCache::self()->invalidate(parseJob->document());
+    m_cache->invalidate(parseJob->document());
+    m_classHierarchy->invalidateFile(parseJob->document());
     if (core()->documentController()->activeDocument() &&
         parseJob->document().toUrl() == core()->documentController()->activeDocument()->url())
         refreshActiveToolView();
@@ -315,6 +376,93 @@ void KDevControlFlowGraphViewPlugin::slotExportControlFlowGraph(bool value)
     action->setData(QVariant::fromValue(DUChainBasePointer()));
 }
 
+void KDevControlFlowGraphViewPlugin::slotFindCallPaths(bool value)
+{
+    Q_UNUSED(value);
+
+    if (!m_activeToolView)
+        return;
+
+    Q_ASSERT(qobject_cast<QAction *>(sender()));
+    QAction *action = static_cast<QAction *>(sender());
+    Q_ASSERT(action->data().canConvert<DUChainBasePointer>());
+
+    IndexedDeclaration target;
+    {
+        DUChainReadLocker lock(DUChain::lock());
+        DeclarationPointer declarationPointer = qvariant_cast<DUChainBasePointer>(action->data()).dynamicCast<Declaration>();
+        if (!declarationPointer)
+            return;
+        target = IndexedDeclaration(declarationPointer.data());
+    }
+    m_activeToolView->findCallPaths(target);
+}
+
+void KDevControlFlowGraphViewPlugin::slotFindUnreachableFunctions(bool value)
+{
+    Q_UNUSED(value);
+
+    IProject *project = analysisProject();
+    if (!project)
+        return;
+
+    bool ok;
+    QString entryPoints = QInputDialog::getText((QWidget *) core()->uiController()->activeMainWindow(),
+                                                i18n("Find Unreachable Functions"),
+                                                i18n("Entry points (qualified names separated by commas, wildcards allowed). Qt slots are always entry points:"),
+                                                QLineEdit::Normal, "main", &ok);
+    if (!ok)
+        return;
+
+    // Libraries are entered through their headers, applications only through the names given above
+    int exportedSymbols = KMessageBox::questionYesNo((QWidget *) core()->uiController()->activeMainWindow(),
+                                                     i18n("Are the functions exported by the project headers entry points too? "
+                                                          "They are the public functions declared in the project headers, "
+                                                          "outside anonymous namespaces."),
+                                                     i18n("Find Unreachable Functions"));
+
+    startProjectAnalysis(project, new ControlFlowGraphReachability(project, entryPoints.split(','), exportedSymbols == KMessageBox::Yes));
+}
+
+void KDevControlFlowGraphViewPlugin::slotComputeCallMetrics(bool value)
+{
+    Q_UNUSED(value);
+
+    IProject *project = analysisProject();
+    if (!project)
+        return;
+
+    startProjectAnalysis(project, new ControlFlowGraphMetrics(project));
+}
+
+IProject *KDevControlFlowGraphViewPlugin::analysisProject()
+{
+    if (m_duchainControlFlow || m_dotControlFlowGraph)
+    {
+        KMessageBox::error((QWidget *) core()->uiController()->activeMainWindow(), i18n("There is a graph being currently exported. Please stop it before requiring a new one"));
+        return 0;
+    }
+
+    Q_ASSERT(qobject_cast<QAction *>(sender()));
+    QAction *action = static_cast<QAction *>(sender());
+    Q_ASSERT(action->data().canConvert<QString>());
+    QString projectName = qvariant_cast<QString>(action->data());
+
+    IProject *project = core()->projectController()->findProjectByName(projectName);
+    if (!project)
+        KMessageBox::error((QWidget *) core()->uiController()->activeMainWindow(), i18n("Could not analyze project %1 - project not found", projectName));
+    return project;
+}
+
+void KDevControlFlowGraphViewPlugin::startProjectAnalysis(IProject *project, ControlFlowGraphProjectAnalysis *analysis)
+{
+    m_projectAnalysis = analysis;
+    DUChainControlFlowJob *job = new DUChainControlFlowJob(project->name(), this);
+    job->setControlFlowJobType(DUChainControlFlowInternalJob::ControlFlowJobProjectAnalysis);
+    connect (job, SIGNAL(result(KJob*)), SLOT(projectAnalysisDone(KJob*)));
+    ICore::self()->runController()->registerJob(job);
+}
+
 void KDevControlFlowGraphViewPlugin::slotExportClassControlFlowGraph(bool value)
 {
     // Export graph for all functions of a given class - individual per-function graphs will be merged
@@ -353,7 +501,8 @@ void KDevControlFlowGraphViewPlugin::slotExportClassControlFlowGraph(bool value)
 
 void KDevControlFlowGraphViewPlugin::slotExportProjectControlFlowGraph(bool value)
 {
-    // Export graph for all classes of a given project - individual per-class graphs will be merged
+    // Export graph for all classes of a given project - individual per-class graphs will be merged,
+    // or written to one file per class when triggered from the "every class" action
     Q_UNUSED(value);
 
     if (m_duchainControlFlow || m_dotControlFlowGraph)
@@ -384,7 +533,9 @@ void KDevControlFlowGraphViewPlugin::slotExportProjectControlFlowGraph(bool valu
     if ((m_fileDialog = exportControlFlowGraph(ControlFlowGraphFileDialog::ForClassConfigurationButtons)))
     {
         DUChainControlFlowJob *job = new DUChainControlFlowJob(projectName, this);
-        job->setControlFlowJobType(DUChainControlFlowInternalJob::ControlFlowJobBatchForProject);
+        job->setControlFlowJobType((action == m_exportProjectClassesControlFlowGraph) ?
+                                   DUChainControlFlowInternalJob::ControlFlowJobBatchForProjectClasses :
+                                   DUChainControlFlowInternalJob::ControlFlowJobBatchForProject);
         m_project = project;
         connect (job, SIGNAL(result(KJob*)), SLOT(generationDone(KJob*)));
         ICore::self()->runController()->registerJob(job);
@@ -394,56 +545,87 @@ void KDevControlFlowGraphViewPlugin::slotExportProjectControlFlowGraph(bool valu
 
 void KDevControlFlowGraphViewPlugin::generateControlFlowGraph()
 {
-    DUChainReadLocker readLock(DUChain::lock());
-
-    Declaration *declaration = m_ideclaration.data();
-    if (!declaration)
-        return;
-
     m_abort = false;
     m_dotControlFlowGraph = new DotControlFlowGraph;
     m_duchainControlFlow = new DUChainControlFlow(m_dotControlFlowGraph);
 
     configureDuchainControlFlow(m_duchainControlFlow, m_dotControlFlowGraph, m_fileDialog);
 
-    m_duchainControlFlow->generateControlFlowForDeclaration(m_ideclaration, IndexedTopDUContext(declaration->topContext()), IndexedDUContext(declaration->internalContext()));
+    if (!generateForDefinition(m_ideclaration))
+        return;
     exportGraph();
 }
 
 void KDevControlFlowGraphViewPlugin::generateClassControlFlowGraph()
 {
-    DUChainReadLocker readLock(DUChain::lock());
+    m_abort = false;
+    m_dotControlFlowGraph = new DotControlFlowGraph;
+    m_duchainControlFlow = new DUChainControlFlow(m_dotControlFlowGraph);
+    
+    configureDuchainControlFlow(m_duchainControlFlow, m_dotControlFlowGraph, m_fileDialog);
 
-    Declaration *declaration = m_ideclaration.data();
-    if (!declaration)
+    // The DUChain is only locked to find the roots and then once per root
+    QString className;
+    QList<IndexedDeclaration> definitions;
+    {
+        DUChainReadLocker readLock(DUChain::lock());
+        Declaration *declaration = m_ideclaration.data();
+        if (!declaration)
+            return;
+        className = declaration->qualifiedIdentifier().toString();
+        definitions = classFunctionDefinitions(declaration);
+    }
+
+    // Methods are independent roots, traversed in parallel and merged into a single graph
+    emit showProgress(this, 0, 0, 0);
+    emit showMessage(this, i18n("Generating graph for class %1", className));
+    m_duchainControlFlow->generateControlFlowForDeclarations(definitions);
+    if (!m_abort && !m_fileDialog->selectedFiles().isEmpty())
+    {
+        emit showMessage(this, i18n("Saving file %1", m_fileDialog->selectedFiles()[0]));
+        exportGraph();
+    }
+    emit hideProgress(this);
+    emit clearMessage(this);
+}
+
+void KDevControlFlowGraphViewPlugin::generateProjectControlFlowGraph()
+{
+    if (!m_project)
         return;
 
     m_abort = false;
     m_dotControlFlowGraph = new DotControlFlowGraph;
     m_duchainControlFlow = new DUChainControlFlow(m_dotControlFlowGraph);
-    
+
     configureDuchainControlFlow(m_duchainControlFlow, m_dotControlFlowGraph, m_fileDialog);
 
-    if (!declaration->isForwardDeclaration() && declaration->internalContext())
+    int i = 0;
+    int max = m_project->fileSet().size();
+    // For each source file
+    foreach(const IndexedString &file, m_project->fileSet())
     {
-        int i = 0;
-        int max = declaration->internalContext()->localDeclarations().size();
-        // For each function declaration
-        ClassFunctionDeclaration *functionDeclaration;
-        foreach (Declaration *decl, declaration->internalContext()->localDeclarations())
+        if (m_abort)
+            break;
+
+        emit showProgress(this, 0, max-1, i);
+        emit showMessage(this, i18n("Generating graph for %1", file.str()));
+        ++i;
+
+        // The roots of a file are collected in one go, then traversed one at a time
+        QList<IndexedDeclaration> definitions;
+        {
+            DUChainReadLocker readLock(DUChain::lock());
+            foreach (const IndexedDeclaration &classDeclaration, classDeclarations(file))
+                if (Declaration *declaration = classDeclaration.data())
+                    definitions << classFunctionDefinitions(declaration);
+        }
+
+        foreach (const IndexedDeclaration &definition, definitions)
         {
             if (m_abort)
                 break;
-
-            emit showProgress(this, 0, max-1, i);
-            emit showMessage(this, i18n("Generating graph for function %1", decl->identifier().toString()));
-            ++i;
-            if ((functionDeclaration = dynamic_cast<ClassFunctionDeclaration *>(decl)))
-            {
-                Declaration *functionDefinition = FunctionDefinition::definition(functionDeclaration);
-                if (functionDefinition)
-                    m_duchainControlFlow->generateControlFlowForDeclaration(IndexedDeclaration(functionDefinition), IndexedTopDUContext(functionDefinition->topContext()), IndexedDUContext(functionDefinition->internalContext()));
-            }
+            generateForDefinition(definition);
         }
     }
     if (!m_abort && !m_fileDialog->selectedFiles().isEmpty())
@@ -451,11 +633,12 @@ void KDevControlFlowGraphViewPlugin::generateClassControlFlowGraph()
         emit showMessage(this, i18n("Saving file %1", m_fileDialog->selectedFiles()[0]));
         exportGraph();
     }
+    m_project = 0;
     emit hideProgress(this);
     emit clearMessage(this);
 }
 
-void KDevControlFlowGraphViewPlugin::generateProjectControlFlowGraph()
+void KDevControlFlowGraphViewPlugin::generateProjectClassesControlFlowGraphs()
 {
     if (!m_project)
         return;
@@ -466,74 +649,174 @@ void KDevControlFlowGraphViewPlugin::generateProjectControlFlowGraph()
 
     configureDuchainControlFlow(m_duchainControlFlow, m_dotControlFlowGraph, m_fileDialog);
 
-    DUChainReadLocker readLock(DUChain::lock());
-
+    QSet<IndexedDeclaration> exportedClasses;
+    QSet<QString> exportedBaseNames;
     int i = 0;
     int max = m_project->fileSet().size();
     // For each source file
     foreach(const IndexedString &file, m_project->fileSet())
     {
+        if (m_abort)
+            break;
+
         emit showProgress(this, 0, max-1, i);
         ++i;
 
-        uint codeModelItemCount = 0;
-        const CodeModelItem *codeModelItems = 0;
-        CodeModel::self().items(file, codeModelItemCount, codeModelItems);
-        
-        for (uint codeModelItemIndex = 0; codeModelItemIndex < codeModelItemCount; ++codeModelItemIndex)
+        QList<IndexedDeclaration> classes;
+        {
+            DUChainReadLocker readLock(DUChain::lock());
+            classes = classDeclarations(file);
+        }
+
+        // For each class declaration, one graph per class
+        foreach (const IndexedDeclaration &classDeclaration, classes)
         {
-            const CodeModelItem &item = codeModelItems[codeModelItemIndex];
-            
-            if ((item.kind & CodeModelItem::Class) && !item.id.identifier().last().toString().isEmpty())
+            if (m_abort)
+                break;
+            if (exportedClasses.contains(classDeclaration))
+                continue;
+            exportedClasses.insert(classDeclaration);
+
+            // The class may be gone since its file was visited
+            QString className;
+            QList<IndexedDeclaration> definitions;
             {
-                uint declarationCount = 0;
-                const IndexedDeclaration *declarations = 0;
-                PersistentSymbolTable::self().declarations(item.id.identifier(), declarationCount, declarations);
-                // For each class declaration
-                for (uint j = 0; j < declarationCount; ++j)
-                {
-                    Declaration *declaration = dynamic_cast<Declaration *>(declarations[j].declaration());
-                    if (declaration && !declaration->isForwardDeclaration() && declaration->internalContext())
-                    {
-                        // For each function declaration
-                        ClassFunctionDeclaration *functionDeclaration;
-                        foreach (Declaration *decl, declaration->internalContext()->localDeclarations())
-                        {
-                            emit showMessage(this, i18n("Generating graph for %1 - %2", file.str(), decl->qualifiedIdentifier().toString()));
-                            if ((functionDeclaration = dynamic_cast<ClassFunctionDeclaration *>(decl)))
-                            {
-                                if (m_abort)
-                                    break;
-                                
-                                Declaration *functionDefinition = FunctionDefinition::definition(functionDeclaration);
-                                if (functionDefinition)
-                                    m_duchainControlFlow->generateControlFlowForDeclaration(IndexedDeclaration(functionDefinition), IndexedTopDUContext(functionDefinition->topContext()), IndexedDUContext(functionDefinition->internalContext()));
-                            }
-                        }
-                        if (m_abort)
-                            break;
-                    }
-                }
-                if (m_abort)
-                    break;
+                DUChainReadLocker readLock(DUChain::lock());
+                Declaration *declaration = classDeclaration.data();
+                if (!declaration)
+                    continue;
+                className = declaration->qualifiedIdentifier().toString();
+                definitions = classFunctionDefinitions(declaration);
+            }
+
+            emit showMessage(this, i18n("Generating graph for class %1", className));
+            m_duchainControlFlow->newGraph();
+            m_duchainControlFlow->generateControlFlowForDeclarations(definitions);
+            if (m_abort)
+                continue;
+
+            // Distinct classes may flatten to the same file name, such as a::b_c and a_b::c
+            QString baseName = className.replace("::", "_");
+            if (exportedBaseNames.contains(baseName))
+            {
+                int suffix = 2;
+                while (exportedBaseNames.contains(baseName + '_' + QString::number(suffix)))
+                    ++suffix;
+                baseName += '_' + QString::number(suffix);
             }
+            exportedBaseNames.insert(baseName);
+            exportGraph(baseName);
         }
-        if (m_abort)
-            break;
     }
-    if (!m_abort && !m_fileDialog->selectedFiles().isEmpty())
+    m_project = 0;
+    emit hideProgress(this);
+    emit clearMessage(this);
+}
+
+QList<IndexedDeclaration> KDevControlFlowGraphViewPlugin::classDeclarations(const IndexedString &file) const
+{
+    QList<IndexedDeclaration> classes;
+
+    uint codeModelItemCount = 0;
+    const CodeModelItem *codeModelItems = 0;
+    CodeModel::self().items(file, codeModelItemCount, codeModelItems);
+
+    for (uint codeModelItemIndex = 0; codeModelItemIndex < codeModelItemCount; ++codeModelItemIndex)
     {
-        emit showMessage(this, i18n("Saving file %1", m_fileDialog->selectedFiles()[0]));
-        exportGraph();
+        const CodeModelItem &item = codeModelItems[codeModelItemIndex];
+
+        if ((item.kind & CodeModelItem::Class) && !item.id.identifier().last().toString().isEmpty())
+        {
+            uint declarationCount = 0;
+            const IndexedDeclaration *declarations = 0;
+            PersistentSymbolTable::self().declarations(item.id.identifier(), declarationCount, declarations);
+            for (uint j = 0; j < declarationCount; ++j)
+            {
+                Declaration *declaration = dynamic_cast<Declaration *>(declarations[j].declaration());
+                if (declaration && !declaration->isForwardDeclaration() && declaration->internalContext() &&
+                    !classes.contains(declarations[j]))
+                    classes << declarations[j];
+            }
+        }
     }
-    m_project = 0;
+    return classes;
+}
+
+QList<IndexedDeclaration> KDevControlFlowGraphViewPlugin::classFunctionDefinitions(Declaration *classDeclaration) const
+{
+    QList<IndexedDeclaration> definitions;
+    if (classDeclaration->isForwardDeclaration() || !classDeclaration->internalContext())
+        return definitions;
+
+    ClassFunctionDeclaration *functionDeclaration;
+    foreach (Declaration *decl, classDeclaration->internalContext()->localDeclarations())
+        if ((functionDeclaration = dynamic_cast<ClassFunctionDeclaration *>(decl)))
+            if (Declaration *functionDefinition = FunctionDefinition::definition(functionDeclaration))
+                definitions << IndexedDeclaration(functionDefinition);
+    return definitions;
+}
+
+bool KDevControlFlowGraphViewPlugin::generateForDefinition(const IndexedDeclaration &idefinition)
+{
+    IndexedTopDUContext itopContext;
+    IndexedDUContext iinternalContext;
+    {
+        // The definition may have been removed while the lock was released
+        DUChainReadLocker readLock(DUChain::lock());
+        Declaration *definition = idefinition.data();
+        if (!definition)
+            return false;
+        itopContext = IndexedTopDUContext(definition->topContext());
+        iinternalContext = IndexedDUContext(definition->internalContext());
+    }
+
+    // Locks by itself and yields to writers while traversing
+    m_duchainControlFlow->generateControlFlowForDeclaration(idefinition, itopContext, iinternalContext);
+    return true;
+}
+
+void KDevControlFlowGraphViewPlugin::analyzeProject()
+{
+    if (!m_projectAnalysis)
+        return;
+
+    m_abort = false;
+    // Analyses only query calls, nothing is drawn
+    m_duchainControlFlow = new DUChainControlFlow(0);
+    m_duchainControlFlow->setCache(m_cache);
+    // Virtual calls may be dispatched to any override, which must be counted as called
+    m_duchainControlFlow->setClassHierarchy(m_classHierarchy);
+    m_duchainControlFlow->setExpandOverrides(true);
+    m_classHierarchy->update();
+
+    emit showProgress(this, 0, 0, 0);
+    emit showMessage(this, m_projectAnalysis->description());
+    m_projectAnalysis->analyze(m_duchainControlFlow, m_abort);
     emit hideProgress(this);
     emit clearMessage(this);
 }
 
+void KDevControlFlowGraphViewPlugin::projectAnalysisDone(KJob *job)
+{
+    job->deleteLater();
+
+    delete m_duchainControlFlow;
+    m_duchainControlFlow = 0;
+
+    if (!m_abort && m_projectAnalysis)
+        m_projectAnalysis->resultDialog(core()->uiController()->activeMainWindow())->show();
+    delete m_projectAnalysis;
+    m_projectAnalysis = 0;
+}
+
 void KDevControlFlowGraphViewPlugin::requestAbort()
 {
     m_abort = true;
+    // Also stops the roots still queued on the thread pool and the layout worker
+    if (m_duchainControlFlow)
+        m_duchainControlFlow->requestAbort();
+    else if (m_dotControlFlowGraph)
+        m_dotControlFlowGraph->abortLayout();
 }
 
 void KDevControlFlowGraphViewPlugin::setActiveToolView(ControlFlowGraphView *activeToolView)
@@ -547,7 +830,9 @@ void KDevControlFlowGraphViewPlugin::generationDone(KJob *job)
     job->deleteLater();
 
     delete m_dotControlFlowGraph;
+    m_dotControlFlowGraph = 0;
     delete m_duchainControlFlow;
+    m_duchainControlFlow = 0;
 
     if (!m_abort)
         KMessageBox::information((QWidget *) (core()->uiController()->activeMainWindow()),
@@ -555,13 +840,13 @@ void KDevControlFlowGraphViewPlugin::generationDone(KJob *job)
                                  i18n("Export Control Flow Graph"));
 }
 
-void KDevControlFlowGraphViewPlugin::exportGraph()
+void KDevControlFlowGraphViewPlugin::exportGraph(const QString &baseName)
 {
-    DotControlFlowGraph::mutex.lock();
+    m_duchainControlFlow->drawGraph();
+
     if (!m_fileDialog->selectedFiles().isEmpty()) {
-        m_dotControlFlowGraph->exportGraph(m_fileDialog->selectedFiles()[0]);
+        m_dotControlFlowGraph->exportGraph(m_fileDialog->exportFileNames(baseName));
     }
-    DotControlFlowGraph::mutex.unlock();
 }
 
 void KDevControlFlowGraphViewPlugin::configureDuchainControlFlow(DUChainControlFlow *duchainControlFlow, DotControlFlowGraph *dotControlFlowGraph, ControlFlowGraphFileDialog *fileDialog)
@@ -572,7 +857,13 @@ void KDevControlFlowGraphViewPlugin::configureDuchainControlFlow(DUChainControlF
     duchainControlFlow->setUseFolderName(fileDialog->useFolderName());
     duchainControlFlow->setUseShortNames(fileDialog->useShortNames());
     duchainControlFlow->setDrawIncomingArcs(fileDialog->drawIncomingArcs());
+    duchainControlFlow->setCache(m_cache);
+    duchainControlFlow->setClassHierarchy(m_classHierarchy);
+    duchainControlFlow->setExpandOverrides(fileDialog->expandOverrides());
+    duchainControlFlow->setCallFilter(fileDialog->callFilter());
 
+    // Exports run unattended, so a pathological graph must not keep the worker busy forever
+    dotControlFlowGraph->setExternalLayout(fileDialog->externalLayout(), 60000);
     dotControlFlowGraph->prepareNewGraph();
 }
 
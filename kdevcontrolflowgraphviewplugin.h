@@ -47,6 +47,9 @@ namespace KTextEditor
 }
 
 class ControlFlowGraphView;
+class ControlFlowGraphCache;
+class ControlFlowGraphClassHierarchy;
+class ControlFlowGraphProjectAnalysis;
 class DUChainControlFlow;
 class DotControlFlowGraph;
 class ControlFlowGraphFileDialog;
@@ -67,11 +70,15 @@ public:
     void registerToolView(ControlFlowGraphView *view);
     void unRegisterToolView(ControlFlowGraphView *view);
     QPointer<ControlFlowGraphFileDialog> exportControlFlowGraph(ControlFlowGraphFileDialog::OpeningMode mode = ControlFlowGraphFileDialog::ConfigurationButtons);
+    ControlFlowGraphCache *cache() const;
+    ControlFlowGraphClassHierarchy *classHierarchy() const;
 
     KDevelop::ContextMenuExtension contextMenuExtension(KDevelop::Context* context);
     void generateControlFlowGraph();
     void generateClassControlFlowGraph();
     void generateProjectControlFlowGraph();
+    void generateProjectClassesControlFlowGraphs();
+    void analyzeProject();
     void requestAbort();
 public Q_SLOTS:
     void projectOpened(KDevelop::IProject* project);
@@ -87,9 +94,13 @@ public Q_SLOTS:
     void slotExportControlFlowGraph(bool value);
     void slotExportClassControlFlowGraph(bool value);
     void slotExportProjectControlFlowGraph(bool value);
+    void slotFindCallPaths(bool value);
+    void slotFindUnreachableFunctions(bool value);
+    void slotComputeCallMetrics(bool value);
     void setActiveToolView(ControlFlowGraphView *activeToolView);
     void generationDone(KJob *job);
-    void exportGraph();
+    void projectAnalysisDone(KJob *job);
+    void exportGraph(const QString &baseName = QString());
 Q_SIGNALS:
     // Implementations of IStatus signals
     void clearMessage(KDevelop::IStatus*);
@@ -98,6 +109,14 @@ Q_SIGNALS:
     void showProgress(KDevelop::IStatus*, int minimum, int maximum, int value);
     void showErrorMessage(const QString&, int);
 private:
+    // Project of the triggering project action, unless another graph or analysis is running
+    IProject *analysisProject();
+    void startProjectAnalysis(IProject *project, ControlFlowGraphProjectAnalysis *analysis);
+    // The DUChain must be read locked
+    QList<IndexedDeclaration> classDeclarations(const IndexedString &file) const;
+    QList<IndexedDeclaration> classFunctionDefinitions(Declaration *classDeclaration) const;
+    // Locks the DUChain by itself, returns false when the definition no longer exists
+    bool generateForDefinition(const IndexedDeclaration &idefinition);
     void configureDuchainControlFlow(DUChainControlFlow *duchainControlFlow, DotControlFlowGraph *dotControlFlowGraph, ControlFlowGraphFileDialog *fileDialog);
 
     ControlFlowGraphView *activeToolView();
@@ -107,6 +126,10 @@ private:
     QAction *m_exportControlFlowGraph;
     QAction *m_exportClassControlFlowGraph;
     QAction *m_exportProjectControlFlowGraph;
+    QAction *m_exportProjectClassesControlFlowGraph;
+    QAction *m_findCallPaths;
+    QAction *m_findUnreachableFunctions;
+    QAction *m_computeCallMetrics;
     
     IndexedDeclaration m_ideclaration;
     IProject *m_project;
@@ -115,6 +138,9 @@ private:
     QPointer<DotControlFlowGraph> m_dotControlFlowGraph;
 
     ControlFlowGraphFileDialog *m_fileDialog;
+    ControlFlowGraphCache *m_cache;
+    ControlFlowGraphClassHierarchy *m_classHierarchy;
+    ControlFlowGraphProjectAnalysis *m_projectAnalysis;
 
     bool m_abort;
 };